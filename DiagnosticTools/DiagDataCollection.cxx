@@ -5,16 +5,888 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOSequenceIOBase.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusBuffer.h"
 #include "vtkPlusDataCollector.h"
 #include "vtkPlusHTMLGenerator.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusDevice.h"
+#include "vtkPlusSequenceIO.h"
 #include "vtkTimerLog.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
 #include "vtksys/SystemTools.hxx"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+//-----------------------------------------------------------------------------
+// Adds a buffer item to the frame list with the same fields as vtkPlusDataSource::WriteToSequenceFile
+PlusStatus AddBufferItemToTrackedFrameList(vtkPlusDataSource* source, bool isTool, BufferItemUidType uid, vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  StreamBufferItem bufferItem;
+  if (source->GetStreamBufferItem(uid, &bufferItem) != ITEM_OK)
+  {
+    return PLUS_FAIL;
+  }
+
+  igsioTrackedFrame trackedFrame;
+  if (isTool)
+  {
+    igsioTransformName toolToReferenceTransformName(source->GetId(), source->GetReferenceCoordinateFrameName());
+    vtkSmartPointer<vtkMatrix4x4> toolToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    bufferItem.GetMatrix(toolToReferenceMatrix);
+    trackedFrame.SetFrameTransform(toolToReferenceTransformName, toolToReferenceMatrix);
+    trackedFrame.SetFrameTransformStatus(toolToReferenceTransformName, bufferItem.GetStatus());
+  }
+  else
+  {
+    trackedFrame.SetImageData(bufferItem.GetFrame());
+  }
+
+  trackedFrame.SetTimestamp(bufferItem.GetFilteredTimestamp(source->GetLocalTimeOffsetSec()));
+  std::ostringstream unfilteredTimestamp;
+  unfilteredTimestamp << std::fixed << bufferItem.GetUnfilteredTimestamp(source->GetLocalTimeOffsetSec());
+  trackedFrame.SetFrameField("UnfilteredTimestamp", unfilteredTimestamp.str());
+  std::ostringstream frameNumber;
+  frameNumber << std::fixed << bufferItem.GetIndex();
+  trackedFrame.SetFrameField("FrameNumber", frameNumber.str());
+
+  trackedFrameList->AddTrackedFrame(&trackedFrame, vtkIGSIOTrackedFrameList::ADD_INVALID_FRAME);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+/*!
+  Appends the new items of a data source buffer to a sequence file while the acquisition is running,
+  so that the recording length is not limited by the buffer size and memory usage does not grow.
+  Items that are overwritten in the circular buffer before they could be written are counted as lost.
+*/
+class DataSourceStreamWriter
+{
+public:
+  DataSourceStreamWriter(vtkPlusDataSource* source, bool isTool, const std::string& fileName)
+    : Source(source)
+    , IsTool(isTool)
+    , FileName(fileName)
+    , PendingFrames(vtkSmartPointer<vtkIGSIOTrackedFrameList>::New())
+    , NextUid(0)
+    , NextUidValid(false)
+    , HeaderPrepared(false)
+    , IsData3D(false)
+    , NumberOfWrittenItems(0)
+    , NumberOfLostItems(0)
+  {
+  }
+
+  PlusStatus Open();
+  /*! Writes all items that have been added to the buffer since the last call */
+  PlusStatus WriteNewItems();
+  /*! Finalizes the file header with the actual number of frames */
+  PlusStatus Close();
+
+  vtkPlusDataSource* GetSource() const { return this->Source; }
+  const std::string& GetFileName() const { return this->FileName; }
+  int GetNumberOfWrittenItems() const { return this->NumberOfWrittenItems; }
+  int GetNumberOfLostItems() const { return this->NumberOfLostItems; }
+
+protected:
+  vtkPlusDataSource* Source;
+  bool IsTool;
+  std::string FileName;
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> Writer;
+  /*! Frames read from the buffer but not yet written, cleared after each write */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> PendingFrames;
+  BufferItemUidType NextUid;
+  bool NextUidValid;
+  bool HeaderPrepared;
+  /*! Volume frames are counted in the last (time) dimension of the header, determined from the first frame */
+  bool IsData3D;
+  int NumberOfWrittenItems;
+  int NumberOfLostItems;
+};
+
+//-----------------------------------------------------------------------------
+PlusStatus DataSourceStreamWriter::Open()
+{
+  this->Writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkPlusSequenceIO::CreateSequenceHandlerForFile(this->FileName));
+  if (this->Writer == NULL)
+  {
+    LOG_ERROR("Unable to create sequence writer for file " << this->FileName);
+    return PLUS_FAIL;
+  }
+  // Frames are appended to the file continuously, therefore it cannot be compressed
+  this->Writer->SetUseCompression(false);
+  this->Writer->SetTrackedFrameList(this->PendingFrames);
+  this->Writer->SetFileName(this->FileName);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus DataSourceStreamWriter::WriteNewItems()
+{
+  if (this->Source->GetNumberOfItems() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  const BufferItemUidType oldestUid = this->Source->GetOldestItemUidInBuffer();
+  const BufferItemUidType latestUid = this->Source->GetLatestItemUidInBuffer();
+  if (!this->NextUidValid)
+  {
+    this->NextUid = oldestUid;
+    this->NextUidValid = true;
+  }
+  if (this->NextUid < oldestUid)
+  {
+    // The writer fell behind and the buffer has been wrapped around
+    this->NumberOfLostItems += static_cast<int>(oldestUid - this->NextUid);
+    this->NextUid = oldestUid;
+  }
+
+  for (; this->NextUid <= latestUid; ++this->NextUid)
+  {
+    if (AddBufferItemToTrackedFrameList(this->Source, this->IsTool, this->NextUid, this->PendingFrames) != PLUS_SUCCESS)
+    {
+      // The item has been overwritten since we queried the buffer range
+      this->NumberOfLostItems++;
+    }
+  }
+
+  if (this->PendingFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  // The header can only be prepared when the first frame (image size, type) is known
+  if (!this->HeaderPrepared)
+  {
+    this->IsData3D = !this->IsTool && this->PendingFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1;
+    if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of " << this->FileName);
+      return PLUS_FAIL;
+    }
+    this->HeaderPrepared = true;
+  }
+  this->NumberOfWrittenItems += this->PendingFrames->GetNumberOfTrackedFrames();
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS || this->Writer->AppendImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write frames to " << this->FileName);
+    status = PLUS_FAIL;
+  }
+  this->PendingFrames->Clear();
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus DataSourceStreamWriter::Close()
+{
+  if (!this->HeaderPrepared)
+  {
+    LOG_WARNING("No frames were written to " << this->FileName);
+    return PLUS_SUCCESS;
+  }
+  this->Writer->UpdateDimensionsCustomStrings(this->NumberOfWrittenItems, this->IsData3D);
+  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
+  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
+  this->Writer->FinalizeHeader();
+  return this->Writer->Close();
+}
+
+//-----------------------------------------------------------------------------
+void StreamWriterThreadFunction(std::vector<DataSourceStreamWriter*>* writers, std::atomic<bool>* stop, double writeIntervalSec)
+{
+  while (!(*stop))
+  {
+    for (std::vector<DataSourceStreamWriter*>::iterator writerIt = writers->begin(); writerIt != writers->end(); ++writerIt)
+    {
+      (*writerIt)->WriteNewItems();
+    }
+    vtksys::SystemTools::Delay(static_cast<unsigned int>(writeIntervalSec * 1000));
+  }
+}
+
+//-----------------------------------------------------------------------------
+/*! Timestamps and frame numbers of the valid items of a data source buffer, stored in contiguous arrays */
+struct BufferSnapshot
+{
+  std::vector<BufferItemUidType> Uids;
+  std::vector<double> Timestamps;
+  std::vector<unsigned long> FrameNumbers;
+};
+
+/*! Number of bins of the frame number gap histogram. The last bin counts all gaps of this size or larger. */
+static const int NUMBER_OF_FRAME_NUMBER_GAP_BINS = 6;
+
+/*!
+  Acquisition statistics of a data source, computed from a buffer snapshot.
+  The frame rates and the frame period stdev have the same definition as in vtkPlusDataSource::GetFrameRate.
+*/
+struct BufferStatistics
+{
+  int NumberOfItems;
+  int BufferSize;
+  int NumberOfValidFrames;
+  /*! Number of consecutive items with the same frame number. It may mean too frequent data reading from a device. */
+  int NumberOfNonUniqueFrames;
+  /*! Ideal frame rate, i.e., including the frames that were not recorded (as GetFrameRate(true)) */
+  double NominalFrameRate;
+  /*! Rate of the recorded items (as GetFrameRate(false)) */
+  double ActualFrameRate;
+  /*! Standard deviation of the frame periods of the recorded items (as GetFrameRate(false)) */
+  double FramePeriodStdevSec;
+  /*! Longest time between two consecutive valid items */
+  double MaxFramePeriodSec;
+  /*! FrameNumberGapHistogram[i] is the number of consecutive items where the frame number increased by i */
+  std::vector<int> FrameNumberGapHistogram;
+};
+
+//-----------------------------------------------------------------------------
+// Copies the timestamp and frame number of each buffer item into the snapshot.
+// The data source has no bulk accessor, so each value is still a separate (locked) query, but the buffer
+// is walked only once: all statistics, including the frame rates, are computed from the snapshot arrays.
+void GetBufferSnapshot(vtkPlusDataSource* source, BufferSnapshot& snapshot)
+{
+  snapshot.Uids.clear();
+  snapshot.Timestamps.clear();
+  snapshot.FrameNumbers.clear();
+  if (source->GetNumberOfItems() == 0)
+  {
+    return;
+  }
+  const BufferItemUidType oldestUid = source->GetOldestItemUidInBuffer();
+  const BufferItemUidType latestUid = source->GetLatestItemUidInBuffer();
+  const size_t maxNumberOfItems = static_cast<size_t>(latestUid - oldestUid + 1);
+  snapshot.Uids.reserve(maxNumberOfItems);
+  snapshot.Timestamps.reserve(maxNumberOfItems);
+  snapshot.FrameNumbers.reserve(maxNumberOfItems);
+  for (BufferItemUidType frameUid = oldestUid; frameUid <= latestUid; ++frameUid)
+  {
+    double time(0);
+    if (source->GetTimeStamp(frameUid, time) != ITEM_OK)
+    {
+      continue;
+    }
+    unsigned long framenum(0);
+    if (source->GetIndex(frameUid, framenum) != ITEM_OK)
+    {
+      continue;
+    }
+    snapshot.Uids.push_back(frameUid);
+    snapshot.Timestamps.push_back(time);
+    snapshot.FrameNumbers.push_back(framenum);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Computes the statistics of the snapshot in one pass over the arrays.
+// The frame rates follow vtkPlusBuffer::GetFrameRate: periods between consecutive valid items that are not positive
+// are ignored, and for the nominal rate each period is divided by the frame number increment (if it increased).
+void AnalyzeBufferSnapshot(const BufferSnapshot& snapshot, BufferStatistics& stats)
+{
+  const size_t numberOfFrames = snapshot.Uids.size();
+  stats.NumberOfValidFrames = static_cast<int>(numberOfFrames);
+  stats.NumberOfNonUniqueFrames = 0;
+  stats.MaxFramePeriodSec = 0;
+  stats.FrameNumberGapHistogram.assign(NUMBER_OF_FRAME_NUMBER_GAP_BINS, 0);
+
+  // Sums for the mean and variance of the actual and nominal frame periods
+  int numberOfFramePeriods = 0;
+  double actualPeriodSumSec = 0;
+  double actualPeriodSquareSumSec2 = 0;
+  double nominalPeriodSumSec = 0;
+  bool frameNumberNotIncreased = false;
+
+  for (size_t i = 1; i < numberOfFrames; ++i)
+  {
+    if (snapshot.Uids[i] != snapshot.Uids[i - 1] + 1)
+    {
+      // previous item is not valid
+      continue;
+    }
+    const double framePeriodSec = snapshot.Timestamps[i] - snapshot.Timestamps[i - 1];
+    stats.MaxFramePeriodSec = std::max(stats.MaxFramePeriodSec, framePeriodSec);
+
+    unsigned long frameNumberGap = 0;
+    if (snapshot.FrameNumbers[i] > snapshot.FrameNumbers[i - 1])
+    {
+      frameNumberGap = snapshot.FrameNumbers[i] - snapshot.FrameNumbers[i - 1];
+    }
+    else
+    {
+      frameNumberNotIncreased = true;
+    }
+    if (framePeriodSec > 0)
+    {
+      numberOfFramePeriods++;
+      actualPeriodSumSec += framePeriodSec;
+      actualPeriodSquareSumSec2 += framePeriodSec * framePeriodSec;
+      nominalPeriodSumSec += (frameNumberGap > 0) ? framePeriodSec / frameNumberGap : framePeriodSec;
+    }
+    if (snapshot.FrameNumbers[i] == snapshot.FrameNumbers[i - 1])
+    {
+      // the same frame number was set for different frame indexes; this should not happen
+      LOG_DEBUG("Non-unique frame has been found with frame number " << snapshot.FrameNumbers[i] << " (uid: " << snapshot.Uids[i - 1] << ", " << snapshot.Uids[i]
+                << ", time: " << snapshot.Timestamps[i - 1] << ", " << snapshot.Timestamps[i] << ")");
+      stats.NumberOfNonUniqueFrames++;
+    }
+    stats.FrameNumberGapHistogram[std::min<unsigned long>(frameNumberGap, NUMBER_OF_FRAME_NUMBER_GAP_BINS - 1)]++;
+  }
+
+  stats.ActualFrameRate = 0;
+  stats.NominalFrameRate = 0;
+  stats.FramePeriodStdevSec = 0;
+  if (numberOfFramePeriods == 0)
+  {
+    LOG_WARNING("Cannot compute frame rate, there are not enough frames in the buffer");
+    return;
+  }
+  if (frameNumberNotIncreased)
+  {
+    LOG_WARNING("Cannot compute ideal frame rate accurately, as frame numbers are invalid or duplicated");
+  }
+  const double actualPeriodMeanSec = actualPeriodSumSec / numberOfFramePeriods;
+  stats.ActualFrameRate = 1.0 / actualPeriodMeanSec;
+  stats.NominalFrameRate = numberOfFramePeriods / nominalPeriodSumSec;
+  const double actualPeriodVarianceSec2 = actualPeriodSquareSumSec2 / numberOfFramePeriods - actualPeriodMeanSec * actualPeriodMeanSec;
+  stats.FramePeriodStdevSec = std::sqrt(std::max(0.0, actualPeriodVarianceSec2));
+}
+
+//-----------------------------------------------------------------------------
+void AnalyzeDataSource(vtkPlusDataSource* source, BufferStatistics& stats)
+{
+  BufferSnapshot snapshot;
+  GetBufferSnapshot(source, snapshot);
+  AnalyzeBufferSnapshot(snapshot, stats);
+  stats.NumberOfItems = source->GetNumberOfItems();
+  stats.BufferSize = source->GetBufferSize();
+}
+
+//-----------------------------------------------------------------------------
+void LogBufferStatistics(const std::string& sourceName, const BufferStatistics& stats)
+{
+  LOG_INFO(sourceName << " nominal frame rate: " << stats.NominalFrameRate << "fps");
+  LOG_INFO(sourceName << " actual frame rate: " << stats.ActualFrameRate << "fps (frame period stdev: " << stats.FramePeriodStdevSec * 1000.0
+           << "ms, max: " << stats.MaxFramePeriodSec * 1000.0 << "ms)");
+  LOG_INFO("Number of items in the buffer: " << stats.NumberOfItems);
+  LOG_INFO("Buffer size: " << stats.BufferSize);
+  LOG_INFO("Number of valid frames: " << stats.NumberOfValidFrames);
+  LOG_INFO("Number of non-unique frames: " << stats.NumberOfNonUniqueFrames);
+  std::ostringstream gapHistogram;
+  for (int gap = 0; gap < NUMBER_OF_FRAME_NUMBER_GAP_BINS; ++gap)
+  {
+    gapHistogram << (gap > 0 ? ", " : "") << gap << (gap == NUMBER_OF_FRAME_NUMBER_GAP_BINS - 1 ? "+" : "") << ": " << stats.FrameNumberGapHistogram[gap];
+  }
+  LOG_INFO("Frame number increments between consecutive items: " << gapHistogram.str());
+  if (stats.NumberOfNonUniqueFrames > 0)
+  {
+    LOG_WARNING("Non-unique frames are recorded in the buffer, probably the requested acquisition rate is too high");
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Returns the string with the characters escaped that are not allowed in a JSON string literal
+std::string EscapeJsonString(const std::string& str)
+{
+  std::ostringstream escaped;
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    const unsigned char c = static_cast<unsigned char>(*it);
+    switch (c)
+    {
+      case '"': escaped << "\\\""; break;
+      case '\\': escaped << "\\\\"; break;
+      case '\b': escaped << "\\b"; break;
+      case '\f': escaped << "\\f"; break;
+      case '\n': escaped << "\\n"; break;
+      case '\r': escaped << "\\r"; break;
+      case '\t': escaped << "\\t"; break;
+      default:
+        if (c < 0x20)
+        {
+          escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        }
+        else
+        {
+          escaped << *it;
+        }
+    }
+  }
+  return escaped.str();
+}
+
+//-----------------------------------------------------------------------------
+/*!
+  Samples the new items of a data source buffer during acquisition and accumulates
+  frame timing statistics in a time window, which can then be written as one CSV or JSON line.
+*/
+class DataSourceMonitor
+{
+public:
+  DataSourceMonitor(vtkPlusDataSource* source, const std::string& channelId)
+    : Source(source)
+    , ChannelId(channelId)
+    , LastUid(0)
+    , LastUidValid(false)
+    , LastTimestamp(0)
+    , LastFrameNumber(0)
+  {
+    this->ResetWindow();
+  }
+
+  /*! Processes all items that have been added to the buffer since the last call */
+  void Poll();
+  /*! Writes the statistics of the current window and starts a new window */
+  void WriteWindow(std::ostream& os, bool json, double timeSec, double windowLengthSec);
+  static void WriteCsvHeader(std::ostream& os);
+
+protected:
+  void ResetWindow()
+  {
+    this->FramePeriodsSec.clear();
+    this->NumberOfItems = 0;
+    this->NumberOfDuplicateFrames = 0;
+    this->NumberOfTimestampRegressions = 0;
+    this->NumberOfSkippedFrames = 0;
+    this->NumberOfMissedItems = 0;
+  }
+
+  vtkPlusDataSource* Source;
+  std::string ChannelId;
+  BufferItemUidType LastUid;
+  bool LastUidValid;
+  double LastTimestamp;
+  unsigned long LastFrameNumber;
+
+  // Statistics of the current window
+  std::vector<double> FramePeriodsSec;
+  int NumberOfItems;
+  /*! Items with the same frame number as the previous item */
+  int NumberOfDuplicateFrames;
+  /*! Items with a timestamp that is not later than the timestamp of the previous item */
+  int NumberOfTimestampRegressions;
+  /*! Frames that the device skipped (based on the frame numbers) */
+  unsigned long NumberOfSkippedFrames;
+  /*! Items that were overwritten in the buffer before they could be sampled */
+  int NumberOfMissedItems;
+};
+
+//-----------------------------------------------------------------------------
+void DataSourceMonitor::Poll()
+{
+  if (this->Source->GetNumberOfItems() == 0)
+  {
+    return;
+  }
+  const BufferItemUidType oldestUid = this->Source->GetOldestItemUidInBuffer();
+  const BufferItemUidType latestUid = this->Source->GetLatestItemUidInBuffer();
+  BufferItemUidType frameUid = this->LastUidValid ? this->LastUid + 1 : latestUid;
+  if (frameUid < oldestUid)
+  {
+    this->NumberOfMissedItems += static_cast<int>(oldestUid - frameUid);
+    frameUid = oldestUid;
+  }
+  for (; frameUid <= latestUid; ++frameUid)
+  {
+    double time(0);
+    unsigned long framenum(0);
+    if (this->Source->GetTimeStamp(frameUid, time) != ITEM_OK || this->Source->GetIndex(frameUid, framenum) != ITEM_OK)
+    {
+      this->NumberOfMissedItems++;
+      continue;
+    }
+    if (this->LastUidValid)
+    {
+      const double framePeriodSec = time - this->LastTimestamp;
+      if (framePeriodSec <= 0)
+      {
+        this->NumberOfTimestampRegressions++;
+      }
+      else
+      {
+        this->FramePeriodsSec.push_back(framePeriodSec);
+      }
+      if (framenum == this->LastFrameNumber)
+      {
+        this->NumberOfDuplicateFrames++;
+      }
+      else if (framenum > this->LastFrameNumber + 1)
+      {
+        this->NumberOfSkippedFrames += framenum - this->LastFrameNumber - 1;
+      }
+    }
+    this->NumberOfItems++;
+    this->LastUid = frameUid;
+    this->LastUidValid = true;
+    this->LastTimestamp = time;
+    this->LastFrameNumber = framenum;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void DataSourceMonitor::WriteCsvHeader(std::ostream& os)
+{
+  os << "TimeSec,Channel,Source,NumberOfItems,FrameRate,FramePeriodP50Ms,FramePeriodP99Ms,FramePeriodMaxMs,"
+     << "DuplicateFrames,TimestampRegressions,SkippedFrames,MissedItems" << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void DataSourceMonitor::WriteWindow(std::ostream& os, bool json, double timeSec, double windowLengthSec)
+{
+  double periodP50Ms = 0;
+  double periodP99Ms = 0;
+  double periodMaxMs = 0;
+  if (!this->FramePeriodsSec.empty())
+  {
+    std::vector<double>::iterator p50It = this->FramePeriodsSec.begin() + (this->FramePeriodsSec.size() - 1) / 2;
+    std::nth_element(this->FramePeriodsSec.begin(), p50It, this->FramePeriodsSec.end());
+    periodP50Ms = (*p50It) * 1000.0;
+    std::vector<double>::iterator p99It = this->FramePeriodsSec.begin() + static_cast<size_t>((this->FramePeriodsSec.size() - 1) * 0.99);
+    std::nth_element(this->FramePeriodsSec.begin(), p99It, this->FramePeriodsSec.end());
+    periodP99Ms = (*p99It) * 1000.0;
+    periodMaxMs = (*std::max_element(this->FramePeriodsSec.begin(), this->FramePeriodsSec.end())) * 1000.0;
+  }
+  const double frameRate = (windowLengthSec > 0) ? this->NumberOfItems / windowLengthSec : 0;
+
+  if (json)
+  {
+    os << "{\"TimeSec\": " << timeSec
+       << ", \"Channel\": \"" << EscapeJsonString(this->ChannelId) << "\""
+       << ", \"Source\": \"" << EscapeJsonString(this->Source->GetId()) << "\""
+       << ", \"NumberOfItems\": " << this->NumberOfItems
+       << ", \"FrameRate\": " << frameRate
+       << ", \"FramePeriodP50Ms\": " << periodP50Ms
+       << ", \"FramePeriodP99Ms\": " << periodP99Ms
+       << ", \"FramePeriodMaxMs\": " << periodMaxMs
+       << ", \"DuplicateFrames\": " << this->NumberOfDuplicateFrames
+       << ", \"TimestampRegressions\": " << this->NumberOfTimestampRegressions
+       << ", \"SkippedFrames\": " << this->NumberOfSkippedFrames
+       << ", \"MissedItems\": " << this->NumberOfMissedItems
+       << "}" << std::endl;
+  }
+  else
+  {
+    os << timeSec << "," << this->ChannelId << "," << this->Source->GetId() << "," << this->NumberOfItems << "," << frameRate << ","
+       << periodP50Ms << "," << periodP99Ms << "," << periodMaxMs << ","
+       << this->NumberOfDuplicateFrames << "," << this->NumberOfTimestampRegressions << "," << this->NumberOfSkippedFrames << "," << this->NumberOfMissedItems << std::endl;
+  }
+  this->ResetWindow();
+}
+
+//-----------------------------------------------------------------------------
+std::string GetOutputSequenceFileName(const std::string& prefix, vtkPlusChannel* channel, vtkPlusDataSource* source, const std::string& extension)
+{
+  return vtkPlusConfig::GetInstance()->GetOutputPath(prefix + "-" + channel->GetChannelId() + "-" + source->GetId() + extension);
+}
+
+//-----------------------------------------------------------------------------
+/*! Analysis and writing of the buffer of one data source, processed by a report worker thread */
+struct DataSourceReportTask
+{
+  DataSourceReportTask(vtkPlusChannel* channel, vtkPlusDataSource* source, bool isTool, const std::string& outputFileName)
+    : Channel(channel)
+    , Source(source)
+    , IsTool(isTool)
+    , OutputFileName(outputFileName)
+    , WriteStatus(PLUS_SUCCESS)
+  {
+  }
+  vtkPlusChannel* Channel;
+  vtkPlusDataSource* Source;
+  bool IsTool;
+  /*! Name of the output sequence file, empty if the buffer does not have to be written */
+  std::string OutputFileName;
+  BufferStatistics Statistics;
+  PlusStatus WriteStatus;
+};
+
+//-----------------------------------------------------------------------------
+/*! Counting semaphore that limits the number of concurrent file writes */
+class WriteSlots
+{
+public:
+  explicit WriteSlots(int numberOfSlots) : NumberOfAvailableSlots(numberOfSlots) {}
+  void Acquire()
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->SlotReleased.wait(lock, [this] { return this->NumberOfAvailableSlots > 0; });
+    this->NumberOfAvailableSlots--;
+  }
+  void Release()
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      this->NumberOfAvailableSlots++;
+    }
+    this->SlotReleased.notify_one();
+  }
+protected:
+  std::mutex Mutex;
+  std::condition_variable SlotReleased;
+  int NumberOfAvailableSlots;
+};
+
+//-----------------------------------------------------------------------------
+// Writes the buffer of a data source to a sequence file, equivalent to vtkPlusDataSource::WriteToSequenceFile.
+// All objects that are modified while writing (frame list, sequence writer) are created for this call only,
+// the data source buffer is only read, so multiple data sources can be written concurrently.
+PlusStatus WriteDataSourceToSequenceFile(vtkPlusDataSource* source, bool isTool, const std::string& fileName, bool useCompression)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (source->GetNumberOfItems() > 0)
+  {
+    const BufferItemUidType oldestUid = source->GetOldestItemUidInBuffer();
+    const BufferItemUidType latestUid = source->GetLatestItemUidInBuffer();
+    for (BufferItemUidType frameUid = oldestUid; frameUid <= latestUid; ++frameUid)
+    {
+      if (AddBufferItemToTrackedFrameList(source, isTool, frameUid, trackedFrameList) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Unable to get frame from buffer " << source->GetId() << " with UID " << frameUid);
+      }
+    }
+  }
+  // vtkPlusSequenceIO::Write creates a new sequence writer for each call
+  if (vtkPlusSequenceIO::Write(fileName, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write buffer " << source->GetId() << " to " << fileName);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Analyzes and writes the data sources on a pool of worker threads.
+// Analysis runs in parallel on all threads, while at most maxNumberOfParallelWrites files are written at the same time.
+// Each write uses its own frame list and sequence writer, so only the disk bandwidth is shared between the writes.
+void ProcessReportTasks(std::vector<DataSourceReportTask>& tasks, int numberOfThreads, int maxNumberOfParallelWrites, bool useCompression)
+{
+  std::atomic<size_t> nextTaskIndex(0);
+  WriteSlots writeSlots(std::max(1, maxNumberOfParallelWrites));
+  auto worker = [&]()
+  {
+    for (size_t taskIndex = nextTaskIndex++; taskIndex < tasks.size(); taskIndex = nextTaskIndex++)
+    {
+      DataSourceReportTask& task = tasks[taskIndex];
+      AnalyzeDataSource(task.Source, task.Statistics);
+      if (!task.OutputFileName.empty())
+      {
+        // The frame list is built in the write slot as well, so that memory usage is also limited
+        writeSlots.Acquire();
+        task.WriteStatus = WriteDataSourceToSequenceFile(task.Source, task.IsTool, task.OutputFileName, useCompression);
+        writeSlots.Release();
+      }
+    }
+  };
+
+  numberOfThreads = std::max(1, std::min(numberOfThreads, static_cast<int>(tasks.size())));
+  std::vector<std::thread> threads;
+  for (int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    threads.push_back(std::thread(worker));
+  }
+  // The calling thread is one of the workers
+  worker();
+  for (std::vector<std::thread>::iterator threadIt = threads.begin(); threadIt != threads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Returns a scalar metric of the statistics by name, so that thresholds can refer to any of them.
+PlusStatus GetStatisticsMetric(const BufferStatistics& stats, const std::string& metricName, double& value)
+{
+  if (metricName == "NumberOfItems") { value = stats.NumberOfItems; }
+  else if (metricName == "BufferSize") { value = stats.BufferSize; }
+  else if (metricName == "NumberOfValidFrames") { value = stats.NumberOfValidFrames; }
+  else if (metricName == "NumberOfNonUniqueFrames") { value = stats.NumberOfNonUniqueFrames; }
+  else if (metricName == "NominalFrameRate") { value = stats.NominalFrameRate; }
+  else if (metricName == "ActualFrameRate") { value = stats.ActualFrameRate; }
+  else if (metricName == "ActualToNominalFrameRateRatio") { value = (stats.NominalFrameRate > 0) ? stats.ActualFrameRate / stats.NominalFrameRate : 0; }
+  else if (metricName == "FramePeriodStdevMs") { value = stats.FramePeriodStdevSec * 1000.0; }
+  else if (metricName == "MaxFramePeriodMs") { value = stats.MaxFramePeriodSec * 1000.0; }
+  else
+  {
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+/*! Names of the metrics written to the statistics file, in output order */
+static const char* STATISTICS_METRIC_NAMES[] =
+{
+  "NumberOfItems", "BufferSize", "NumberOfValidFrames", "NumberOfNonUniqueFrames", "NominalFrameRate", "ActualFrameRate",
+  "ActualToNominalFrameRateRatio", "FramePeriodStdevMs", "MaxFramePeriodMs"
+};
+static const int NUMBER_OF_STATISTICS_METRICS = sizeof(STATISTICS_METRIC_NAMES) / sizeof(STATISTICS_METRIC_NAMES[0]);
+
+//-----------------------------------------------------------------------------
+/*!
+  Pass/fail limit of a statistics metric. Empty channel or source identifier matches all channels or sources.
+  Example threshold file:
+  <StatsThresholds>
+    <Threshold Metric="ActualToNominalFrameRateRatio" Min="0.95" />
+    <Threshold ChannelId="VideoStream" SourceId="Video" Metric="NumberOfNonUniqueFrames" Max="0" />
+  </StatsThresholds>
+*/
+struct StatsThreshold
+{
+  std::string ChannelId;
+  std::string SourceId;
+  std::string Metric;
+  bool HasMin;
+  double Min;
+  bool HasMax;
+  double Max;
+};
+
+//-----------------------------------------------------------------------------
+PlusStatus ReadStatsThresholds(const std::string& fileName, std::vector<StatsThreshold>& thresholds)
+{
+  vtkSmartPointer<vtkXMLDataElement> rootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(fileName.c_str()));
+  if (rootElement == NULL)
+  {
+    LOG_ERROR("Unable to read statistics thresholds from file " << fileName);
+    return PLUS_FAIL;
+  }
+  thresholds.clear();
+  for (int i = 0; i < rootElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* thresholdElement = rootElement->GetNestedElement(i);
+    if (thresholdElement == NULL || STRCASECMP(thresholdElement->GetName(), "Threshold") != 0)
+    {
+      continue;
+    }
+    StatsThreshold threshold;
+    threshold.ChannelId = thresholdElement->GetAttribute("ChannelId") ? thresholdElement->GetAttribute("ChannelId") : "";
+    threshold.SourceId = thresholdElement->GetAttribute("SourceId") ? thresholdElement->GetAttribute("SourceId") : "";
+    threshold.Metric = thresholdElement->GetAttribute("Metric") ? thresholdElement->GetAttribute("Metric") : "";
+    double value(0);
+    BufferStatistics emptyStats = BufferStatistics();
+    if (GetStatisticsMetric(emptyStats, threshold.Metric, value) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid Metric attribute in threshold element " << i << " of " << fileName << ": '" << threshold.Metric << "'");
+      return PLUS_FAIL;
+    }
+    threshold.HasMin = (thresholdElement->GetScalarAttribute("Min", threshold.Min) != 0);
+    threshold.HasMax = (thresholdElement->GetScalarAttribute("Max", threshold.Max) != 0);
+    if (!threshold.HasMin && !threshold.HasMax)
+    {
+      LOG_ERROR("Threshold element " << i << " of " << fileName << " has neither Min nor Max attribute");
+      return PLUS_FAIL;
+    }
+    thresholds.push_back(threshold);
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluates all thresholds on all data sources and returns the description of each violation.
+void CheckStatsThresholds(const std::vector<DataSourceReportTask>& tasks, const std::vector<StatsThreshold>& thresholds, std::vector<std::string>& violations)
+{
+  violations.clear();
+  for (std::vector<DataSourceReportTask>::const_iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+  {
+    for (std::vector<StatsThreshold>::const_iterator thresholdIt = thresholds.begin(); thresholdIt != thresholds.end(); ++thresholdIt)
+    {
+      if ((!thresholdIt->ChannelId.empty() && thresholdIt->ChannelId != taskIt->Channel->GetChannelId())
+          || (!thresholdIt->SourceId.empty() && thresholdIt->SourceId != taskIt->Source->GetId()))
+      {
+        continue;
+      }
+      double value(0);
+      GetStatisticsMetric(taskIt->Statistics, thresholdIt->Metric, value);
+      if ((thresholdIt->HasMin && value < thresholdIt->Min) || (thresholdIt->HasMax && value > thresholdIt->Max))
+      {
+        std::ostringstream violation;
+        violation << taskIt->Channel->GetChannelId() << "/" << taskIt->Source->GetId() << " " << thresholdIt->Metric << " = " << value
+                  << " is out of range [" << (thresholdIt->HasMin ? thresholdIt->Min : -std::numeric_limits<double>::infinity())
+                  << ", " << (thresholdIt->HasMax ? thresholdIt->Max : std::numeric_limits<double>::infinity()) << "]";
+        violations.push_back(violation.str());
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Writes the statistics of all data sources to a JSON or CSV file, depending on the file extension.
+// In CSV files threshold violations are not listed, only the overall result is added as a last line.
+PlusStatus WriteStatsFile(const std::string& fileName, const std::vector<DataSourceReportTask>& tasks, double acquisitionTimeSec,
+                          bool thresholdsChecked, const std::vector<std::string>& violations)
+{
+  std::ofstream os(fileName.c_str());
+  if (!os)
+  {
+    LOG_ERROR("Failed to open statistics output file " << fileName);
+    return PLUS_FAIL;
+  }
+  const bool json = (STRCASECMP(vtksys::SystemTools::GetFilenameLastExtension(fileName).c_str(), ".json") == 0);
+  const char* result = !thresholdsChecked ? "NotChecked" : (violations.empty() ? "Pass" : "Fail");
+  if (json)
+  {
+    os << "{" << std::endl;
+    os << "  \"AcquisitionTimeSec\": " << acquisitionTimeSec << "," << std::endl;
+    os << "  \"Sources\": [" << std::endl;
+    for (std::vector<DataSourceReportTask>::const_iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+    {
+      os << "    {\"Device\": \"" << EscapeJsonString(taskIt->Channel->GetOwnerDevice()->GetDeviceId()) << "\""
+         << ", \"Channel\": \"" << EscapeJsonString(taskIt->Channel->GetChannelId()) << "\""
+         << ", \"Source\": \"" << EscapeJsonString(taskIt->Source->GetId()) << "\""
+         << ", \"Type\": \"" << (taskIt->IsTool ? "Tool" : "Video") << "\"";
+      for (int metricIndex = 0; metricIndex < NUMBER_OF_STATISTICS_METRICS; ++metricIndex)
+      {
+        double value(0);
+        GetStatisticsMetric(taskIt->Statistics, STATISTICS_METRIC_NAMES[metricIndex], value);
+        os << ", \"" << STATISTICS_METRIC_NAMES[metricIndex] << "\": " << value;
+      }
+      os << "}" << (taskIt + 1 != tasks.end() ? "," : "") << std::endl;
+    }
+    os << "  ]," << std::endl;
+    os << "  \"Result\": \"" << result << "\"," << std::endl;
+    os << "  \"ThresholdViolations\": [";
+    for (std::vector<std::string>::const_iterator violationIt = violations.begin(); violationIt != violations.end(); ++violationIt)
+    {
+      os << (violationIt != violations.begin() ? ", " : "") << "\"" << EscapeJsonString(*violationIt) << "\"";
+    }
+    os << "]" << std::endl;
+    os << "}" << std::endl;
+  }
+  else
+  {
+    os << "Device,Channel,Source,Type";
+    for (int metricIndex = 0; metricIndex < NUMBER_OF_STATISTICS_METRICS; ++metricIndex)
+    {
+      os << "," << STATISTICS_METRIC_NAMES[metricIndex];
+    }
+    os << std::endl;
+    for (std::vector<DataSourceReportTask>::const_iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+    {
+      os << taskIt->Channel->GetOwnerDevice()->GetDeviceId() << "," << taskIt->Channel->GetChannelId() << "," << taskIt->Source->GetId()
+         << "," << (taskIt->IsTool ? "Tool" : "Video");
+      for (int metricIndex = 0; metricIndex < NUMBER_OF_STATISTICS_METRICS; ++metricIndex)
+      {
+        double value(0);
+        GetStatisticsMetric(taskIt->Statistics, STATISTICS_METRIC_NAMES[metricIndex], value);
+        os << "," << value;
+      }
+      os << std::endl;
+    }
+    os << "# Result: " << result << std::endl;
+  }
+  return os.good() ? PLUS_SUCCESS : PLUS_FAIL;
+}
+
+//-----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
   bool printHelp(false);
@@ -22,6 +894,19 @@ int main(int argc, char** argv)
   double inputAcqTimeLength(60);
   std::vector<std::string> acqChannelIds;
   std::string outputSequenceFileNamePrefix = "Diag";
+  bool streamToFile(false);
+  double streamWriteIntervalSec(0.5);
+  bool monitor(false);
+  double monitorIntervalSec(1.0);
+  double monitorPollIntervalSec(0.01);
+  std::string monitorFormat = "CSV";
+  std::string monitorOutputFileName;
+  int numberOfReportThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  int maxNumberOfParallelWrites = 2;
+  bool useCompression(false);
+  std::string outputSequenceFileExtension = ".mha";
+  std::string outputStatsFileName;
+  std::string statsThresholdsFileName;
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -33,6 +918,19 @@ int main(int argc, char** argv)
   args.AddArgument("--acq-time-length", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputAcqTimeLength, "Length of acquisition time in seconds (Default: 60s)");
   args.AddArgument("--acq-channel-ids", vtksys::CommandLineArguments::MULTI_ARGUMENT, &acqChannelIds, "Identifiers of the output channels that are recorded. If not specified then all channels are recorded.");
   args.AddArgument("--output-seq-file-prefix", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputSequenceFileNamePrefix, "Filename prefix for the recorded output channels (Default: Diag)");
+  args.AddArgument("--output-seq-file-extension", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputSequenceFileExtension, "File extension of the recorded output files, which determines the file format: .mha, .mhd, .nrrd or .nhdr (Default: .mha)");
+  args.AddArgument("--use-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &useCompression, "Compress the recorded output files. Writing is slower, but the files are smaller. Not supported with --stream-to-file.");
+  args.AddArgument("--report-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfReportThreads, "Number of threads analyzing and writing the buffers after the acquisition (Default: number of processor cores)");
+  args.AddArgument("--max-parallel-writes", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxNumberOfParallelWrites, "Maximum number of output files written at the same time (Default: 2)");
+  args.AddArgument("--output-stats", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputStatsFileName, "Write the acquisition statistics of each data source to this file. JSON format if the extension is .json, CSV otherwise.");
+  args.AddArgument("--stats-thresholds", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &statsThresholdsFileName, "XML file with Threshold elements (ChannelId, SourceId, Metric, Min, Max attributes). The program returns with failure if any statistics metric is out of range.");
+  args.AddArgument("--stream-to-file", vtksys::CommandLineArguments::NO_ARGUMENT, &streamToFile, "Write the buffers to the output files continuously during the acquisition instead of at the end. Recording length is then not limited by the buffer size.");
+  args.AddArgument("--stream-write-interval", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &streamWriteIntervalSec, "Time between writing new buffer items to file in streaming mode in seconds (Default: 0.5)");
+  args.AddArgument("--monitor", vtksys::CommandLineArguments::NO_ARGUMENT, &monitor, "Continuously sample all data sources during the acquisition and periodically write frame rate, frame period percentiles, duplicate frames and timestamp regressions");
+  args.AddArgument("--monitor-interval", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &monitorIntervalSec, "Length of the monitoring report window in seconds (Default: 1)");
+  args.AddArgument("--monitor-poll-interval", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &monitorPollIntervalSec, "Time between sampling the data source buffers in monitoring mode in seconds (Default: 0.01)");
+  args.AddArgument("--monitor-format", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &monitorFormat, "Format of the monitoring output: CSV or JSON (one object per line) (Default: CSV)");
+  args.AddArgument("--monitor-output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &monitorOutputFileName, "Name of the monitoring output file. If not specified then the output is written to the standard output.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -56,6 +954,24 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  if (streamToFile && useCompression)
+  {
+    LOG_WARNING("Files written during the acquisition cannot be compressed, --use-compression is ignored");
+  }
+
+  const bool monitorJson = (STRCASECMP(monitorFormat.c_str(), "JSON") == 0);
+  if (!monitorJson && STRCASECMP(monitorFormat.c_str(), "CSV") != 0)
+  {
+    std::cerr << "Invalid --monitor-format: " << monitorFormat << ". Supported formats: CSV, JSON" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<StatsThreshold> statsThresholds;
+  if (!statsThresholdsFileName.empty() && ReadStatsThresholds(statsThresholdsFileName, statsThresholds) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+
   // Find program path
   std::string programPath("./"), errorMsg;
   if (!vtksys::SystemTools::FindProgramPath(argv[0], programPath, errorMsg))
@@ -130,20 +1046,112 @@ int main(int argc, char** argv)
     }
   }
 
+  // Set up writing the buffers during the acquisition
+  std::vector<DataSourceStreamWriter*> streamWriters;
+  if (streamToFile)
+  {
+    for (std::vector< vtkPlusChannel* >::iterator acqChannelIt = acqChannels.begin(); acqChannelIt != acqChannels.end(); ++acqChannelIt)
+    {
+      vtkPlusDataSource* videoSource = NULL;
+      if ((*acqChannelIt)->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
+      {
+        streamWriters.push_back(new DataSourceStreamWriter(videoSource, false, GetOutputSequenceFileName(outputSequenceFileNamePrefix, *acqChannelIt, videoSource, outputSequenceFileExtension)));
+      }
+      for (DataSourceContainerConstIterator it = (*acqChannelIt)->GetToolsStartIterator(); it != (*acqChannelIt)->GetToolsEndIterator(); ++it)
+      {
+        vtkPlusDataSource* tool = it->second;
+        streamWriters.push_back(new DataSourceStreamWriter(tool, true, GetOutputSequenceFileName(outputSequenceFileNamePrefix, *acqChannelIt, tool, outputSequenceFileExtension)));
+      }
+    }
+    for (std::vector<DataSourceStreamWriter*>::iterator writerIt = streamWriters.begin(); writerIt != streamWriters.end(); ++writerIt)
+    {
+      if ((*writerIt)->Open() != PLUS_SUCCESS)
+      {
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
   if (dataCollector->Start() != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to start data collection!");
     exit(EXIT_FAILURE);
   }
 
+  std::atomic<bool> stopStreamWriter(false);
+  std::thread streamWriterThread;
+  if (streamToFile)
+  {
+    streamWriterThread = std::thread(StreamWriterThreadFunction, &streamWriters, &stopStreamWriter, streamWriteIntervalSec);
+  }
+
   const double acqStartTime = vtkTimerLog::GetUniversalTime();
 
   // Record data
-  while (acqStartTime + inputAcqTimeLength > vtkTimerLog::GetUniversalTime())
+  if (monitor)
   {
-    LOG_INFO(acqStartTime + inputAcqTimeLength - vtkTimerLog::GetUniversalTime() << " seconds left...");
-    vtksys::SystemTools::Delay(1000);
+    std::vector<DataSourceMonitor> monitors;
+    for (std::vector< vtkPlusChannel* >::iterator acqChannelIt = acqChannels.begin(); acqChannelIt != acqChannels.end(); ++acqChannelIt)
+    {
+      vtkPlusDataSource* videoSource = NULL;
+      if ((*acqChannelIt)->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
+      {
+        monitors.push_back(DataSourceMonitor(videoSource, (*acqChannelIt)->GetChannelId()));
+      }
+      for (DataSourceContainerConstIterator it = (*acqChannelIt)->GetToolsStartIterator(); it != (*acqChannelIt)->GetToolsEndIterator(); ++it)
+      {
+        monitors.push_back(DataSourceMonitor(it->second, (*acqChannelIt)->GetChannelId()));
+      }
+    }
+
+    std::ofstream monitorOutputFile;
+    if (!monitorOutputFileName.empty())
+    {
+      monitorOutputFile.open(monitorOutputFileName.c_str());
+      if (!monitorOutputFile.is_open())
+      {
+        LOG_ERROR("Unable to open monitoring output file " << monitorOutputFileName);
+        exit(EXIT_FAILURE);
+      }
+    }
+    std::ostream& monitorOutput = monitorOutputFile.is_open() ? monitorOutputFile : std::cout;
+    if (!monitorJson)
+    {
+      DataSourceMonitor::WriteCsvHeader(monitorOutput);
+    }
+
+    double windowStartTime = acqStartTime;
+    double now = acqStartTime;
+    while (acqStartTime + inputAcqTimeLength > now)
+    {
+      for (std::vector<DataSourceMonitor>::iterator monitorIt = monitors.begin(); monitorIt != monitors.end(); ++monitorIt)
+      {
+        monitorIt->Poll();
+      }
+      now = vtkTimerLog::GetUniversalTime();
+      if (now - windowStartTime >= monitorIntervalSec)
+      {
+        for (std::vector<DataSourceMonitor>::iterator monitorIt = monitors.begin(); monitorIt != monitors.end(); ++monitorIt)
+        {
+          monitorIt->WriteWindow(monitorOutput, monitorJson, now - acqStartTime, now - windowStartTime);
+        }
+        windowStartTime = now;
+      }
+      vtksys::SystemTools::Delay(static_cast<unsigned int>(monitorPollIntervalSec * 1000));
+      now = vtkTimerLog::GetUniversalTime();
+    }
   }
+  else
+  {
+    while (acqStartTime + inputAcqTimeLength > vtkTimerLog::GetUniversalTime())
+    {
+      LOG_INFO(acqStartTime + inputAcqTimeLength - vtkTimerLog::GetUniversalTime() << " seconds left...");
+      vtksys::SystemTools::Delay(1000);
+    }
+  }
+
+  // The loops above may overrun the requested time by up to a poll interval, so report the measured time
+  const double acquisitionTimeSec = vtkTimerLog::GetUniversalTime() - acqStartTime;
 
   // Stop recording
   if (dataCollector->Stop() != PLUS_SUCCESS)
@@ -152,149 +1160,70 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  if (streamToFile)
+  {
+    stopStreamWriter = true;
+    streamWriterThread.join();
+    // Write the items acquired since the last write
+    for (std::vector<DataSourceStreamWriter*>::iterator writerIt = streamWriters.begin(); writerIt != streamWriters.end(); ++writerIt)
+    {
+      (*writerIt)->WriteNewItems();
+      (*writerIt)->Close();
+      LOG_INFO("Streamed " << (*writerIt)->GetSource()->GetId() << " buffer to " << (*writerIt)->GetFileName() << ": "
+               << (*writerIt)->GetNumberOfWrittenItems() << " items written, " << (*writerIt)->GetNumberOfLostItems() << " items lost");
+      if ((*writerIt)->GetNumberOfLostItems() > 0)
+      {
+        LOG_WARNING("Items of " << (*writerIt)->GetSource()->GetId() << " were overwritten in the buffer before they could be written to file. Increase the buffer size or decrease --stream-write-interval.");
+      }
+      delete *writerIt;
+    }
+    streamWriters.clear();
+  }
+
   // Print statistics
 
   vtkSmartPointer<vtkPlusHTMLGenerator> htmlReport = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
   htmlReport->SetBaseFilename("DataCollectionReport");
   htmlReport->SetTitle("Data Collection Report");
+
+  // Analyze the buffers and write them to file concurrently
+  std::vector<DataSourceReportTask> reportTasks;
   for (std::vector< vtkPlusChannel* >::iterator acqChannelIt = acqChannels.begin(); acqChannelIt != acqChannels.end(); ++acqChannelIt)
   {
-    LOG_INFO("---------------------------------");
-    LOG_INFO("Device: " << (*acqChannelIt)->GetOwnerDevice()->GetDeviceId());
-    LOG_INFO("Channel: " << (*acqChannelIt)->GetChannelId());
-
-    // Video data
     vtkPlusDataSource* videoSource = NULL;
     if ((*acqChannelIt)->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
     {
-      double realVideoFramePeriodStdevSec = 0;
-      double realVideoFrameRate = videoSource->GetFrameRate(false, &realVideoFramePeriodStdevSec);
-      double idealVideoFrameRate = videoSource->GetFrameRate(true);
-      int numOfItems = videoSource->GetNumberOfItems();
-      int bufferSize = videoSource->GetBufferSize();
-
-      LOG_INFO("Nominal video frame rate: " << idealVideoFrameRate << "fps");
-      LOG_INFO("Actual video frame rate: " << realVideoFrameRate << "fps (frame period stdev: " << realVideoFramePeriodStdevSec * 1000.0 << "ms)");
-      LOG_INFO("Number of items in the video buffer: " << numOfItems);
-      LOG_INFO("Video buffer size: " << bufferSize);
-
-      // Check if the same item index (usually "frame number") is stored in multiple items. It may mean too frequent data reading from a tracking device
-      int numberOfNonUniqueFrames = 0;
-      int numberOfValidFrames = 0;
-      for (BufferItemUidType frameUid = videoSource->GetOldestItemUidInBuffer(); frameUid <= videoSource->GetLatestItemUidInBuffer(); ++frameUid)
-      {
-        double time(0);
-        if (videoSource->GetTimeStamp(frameUid, time) != ITEM_OK)
-        {
-          continue;
-        }
-        unsigned long framenum(0);
-        if (videoSource->GetIndex(frameUid, framenum) != ITEM_OK)
-        {
-          continue;
-        }
-        numberOfValidFrames++;
-        if (frameUid == videoSource->GetOldestItemUidInBuffer())
-        {
-          // no previous frame
-          continue;
-        }
-        double prevtime(0);
-        if (videoSource->GetTimeStamp(frameUid - 1, prevtime) != ITEM_OK)
-        {
-          continue;
-        }
-        unsigned long prevframenum(0);
-        if (videoSource->GetIndex(frameUid - 1, prevframenum) != ITEM_OK)
-        {
-          continue;
-        }
-        if (framenum == prevframenum)
-        {
-          // the same frame number was set for different frame indexes; this should not happen
-          LOG_DEBUG("Non-unique frame has been found with frame number " << framenum << " (uid: " << frameUid - 1 << ", " << frameUid << ", time: " << prevtime << ", " << time << ")");
-          numberOfNonUniqueFrames++;
-        }
-      }
-      LOG_INFO("Number of valid frames: " << numberOfValidFrames);
-      LOG_INFO("Number of non-unique frames: " << numberOfNonUniqueFrames);
-      if (numberOfNonUniqueFrames > 0)
-      {
-        LOG_WARNING("Non-unique frames are recorded in the buffer, probably the requested acquisition rate is too high");
-      }
-
-      // Dump video buffer to file
-      std::string outputVideoBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(outputSequenceFileNamePrefix
-          + "-" + (*acqChannelIt)->GetChannelId() + "-" + videoSource->GetId() + ".mha");
-      LOG_INFO("Write video buffer to " << outputVideoBufferSequenceFileName);
-      videoSource->WriteToSequenceFile(outputVideoBufferSequenceFileName.c_str(), false);
+      reportTasks.push_back(DataSourceReportTask(*acqChannelIt, videoSource, false,
+                            streamToFile ? "" : GetOutputSequenceFileName(outputSequenceFileNamePrefix, *acqChannelIt, videoSource, outputSequenceFileExtension)));
     }
-
-    // Tracker tools
     for (DataSourceContainerConstIterator it = (*acqChannelIt)->GetToolsStartIterator(); it != (*acqChannelIt)->GetToolsEndIterator(); ++it)
     {
-      vtkPlusDataSource* tool = it->second;
+      reportTasks.push_back(DataSourceReportTask(*acqChannelIt, it->second, true,
+                            streamToFile ? "" : GetOutputSequenceFileName(outputSequenceFileNamePrefix, *acqChannelIt, it->second, outputSequenceFileExtension)));
+    }
+  }
+  ProcessReportTasks(reportTasks, numberOfReportThreads, maxNumberOfParallelWrites, useCompression);
+
+  // Print statistics in the original channel order
+  std::vector<DataSourceReportTask>::iterator taskIt = reportTasks.begin();
+  for (std::vector< vtkPlusChannel* >::iterator acqChannelIt = acqChannels.begin(); acqChannelIt != acqChannels.end(); ++acqChannelIt)
+  {
+    LOG_INFO("---------------------------------");
+    LOG_INFO("Device: " << (*acqChannelIt)->GetOwnerDevice()->GetDeviceId());
+    LOG_INFO("Channel: " << (*acqChannelIt)->GetChannelId());
 
-      int numOfItems = tool->GetNumberOfItems();
-      int bufferSize = tool->GetBufferSize();
-      double realFramePeriodStdevSec = 0;
-      double realFrameRate = tool->GetFrameRate(false, &realFramePeriodStdevSec);
-      double idealFrameRate = tool->GetFrameRate(true);
-      LOG_INFO("------------------ " << tool->GetId() << " ---------------------");
-      LOG_INFO("Tracker tool " << tool->GetId() <<  " actual sampling frequency: " << realFrameRate << "fps (sampling period stdev: " << realFramePeriodStdevSec * 1000.0 << "ms)");
-      LOG_INFO("Tracker tool " << tool->GetId() <<  " nominal sampling frequency: " << idealFrameRate << "fps");
-      LOG_INFO("Number of items in the tool buffer: " << numOfItems);
-      LOG_INFO("Tool buffer size: " << bufferSize);
-
-      // Check if the same item index (usually "frame number") is stored in multiple items. It may mean too frequent data reading from a tracking device
-      int numberOfNonUniqueFrames = 0;
-      int numberOfValidFrames = 0;
-      for (BufferItemUidType frameUid = tool->GetOldestItemUidInBuffer(); frameUid <= tool->GetLatestItemUidInBuffer(); ++frameUid)
+    for (; taskIt != reportTasks.end() && taskIt->Channel == (*acqChannelIt); ++taskIt)
+    {
+      LOG_INFO("------------------ " << taskIt->Source->GetId() << " ---------------------");
+      LogBufferStatistics((taskIt->IsTool ? "Tracker tool " : "Video ") + std::string(taskIt->Source->GetId()), taskIt->Statistics);
+      if (!taskIt->OutputFileName.empty())
       {
-        double time(0);
-        if (tool->GetTimeStamp(frameUid, time) != ITEM_OK)
-        {
-          continue;
-        }
-        unsigned long framenum(0);
-        if (tool->GetIndex(frameUid, framenum) != ITEM_OK)
-        {
-          continue;
-        }
-        numberOfValidFrames++;
-        if (frameUid == tool->GetOldestItemUidInBuffer())
-        {
-          // no previous frame
-          continue;
-        }
-        double prevtime(0);
-        if (tool->GetTimeStamp(frameUid - 1, prevtime) != ITEM_OK)
-        {
-          continue;
-        }
-        unsigned long prevframenum(0);
-        if (tool->GetIndex(frameUid - 1, prevframenum) != ITEM_OK)
-        {
-          continue;
-        }
-        if (framenum == prevframenum)
+        LOG_INFO("Written " << (taskIt->IsTool ? "tracker" : "video") << " buffer to " << taskIt->OutputFileName);
+        if (taskIt->WriteStatus != PLUS_SUCCESS)
         {
-          // the same frame number was set for different frame indexes; this should not happen
-          LOG_DEBUG("Non-unique frame has been found with frame number " << framenum << " (uid: " << frameUid - 1 << ", " << frameUid << ", time: " << prevtime << ", " << time << ")");
-          numberOfNonUniqueFrames++;
+          LOG_ERROR("Failed to write " << taskIt->OutputFileName);
         }
       }
-      LOG_INFO("Number of valid frames: " << numberOfValidFrames);
-      LOG_INFO("Number of non-unique frames: " << numberOfNonUniqueFrames);
-      if (numberOfNonUniqueFrames > 0)
-      {
-        LOG_WARNING("Non-unique frames are recorded in the buffer, probably the requested acquisition rate is too high");
-      }
-      // Dump tracker tool buffer to file
-      std::string outputTrackerBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(outputSequenceFileNamePrefix
-          + "-" + (*acqChannelIt)->GetChannelId() + "-" + tool->GetId() + ".mha");
-      LOG_INFO("Write tracker buffer to " << outputTrackerBufferSequenceFileName);
-      tool->WriteToSequenceFile(outputTrackerBufferSequenceFileName.c_str(), false);
     }
 
     // Add info to data acq report
@@ -306,5 +1235,25 @@ int main(int argc, char** argv)
 
   dataCollector->Disconnect();
 
+  std::vector<std::string> thresholdViolations;
+  CheckStatsThresholds(reportTasks, statsThresholds, thresholdViolations);
+  for (std::vector<std::string>::iterator violationIt = thresholdViolations.begin(); violationIt != thresholdViolations.end(); ++violationIt)
+  {
+    LOG_ERROR("Statistics threshold violation: " << *violationIt);
+  }
+  if (!outputStatsFileName.empty())
+  {
+    if (WriteStatsFile(outputStatsFileName, reportTasks, acquisitionTimeSec, !statsThresholdsFileName.empty(), thresholdViolations) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write statistics to " << outputStatsFileName);
+      return EXIT_FAILURE;
+    }
+    LOG_INFO("Statistics written to " << outputStatsFileName);
+  }
+  if (!thresholdViolations.empty())
+  {
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -6,39 +6,247 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
 #include <iostream>
 #include <math.h>
 #include <cstdlib>
 #include <cstring>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
+#include "igtlClientSocket.h"
 #include "igtlImageMessage.h"
 #include "igtlMessageHeader.h"
-#include "igtlMultiThreader.h"
 #include "igtlOSUtil.h"
 #include "igtlServerSocket.h"
+#include "igtlTimeStamp.h"
 #include "igtlTrackingDataMessage.h"
 #include "vtkPlusIgtlMessageFactory.h"
 #include "vtksys/CommandLineArguments.hxx"
 
+typedef std::chrono::steady_clock StreamClock;
 
-void* ThreadFunction(void* ptr);
-int   SendTrackingData(igtl::Socket::Pointer& socket, igtl::TrackingDataMessage::Pointer& trackingMsg);
-void  GetRandomTestMatrix(igtl::Matrix4x4& matrix, float phi, float theta);
+/*! Metadata key of the sequence number embedded in each message in latency probe mode */
+static const char* SEQUENCE_NUMBER_METADATA_KEY = "SequenceNumber";
+
+/*! Maximum time a stream thread may be blocked in sending a message (and so the maximum time needed to stop it) */
+static const int SEND_TIMEOUT_MSEC = 1000;
+
+/*! Send statistics of one client connection. Only accessed by the stream thread of the client. */
+struct ClientStatistics
+{
+  ClientStatistics() { Reset(); }
+  void Reset()
+  {
+    NumberOfMessages = 0;
+    NumberOfBytes = 0;
+    SendStallSec = 0.0;
+    NumberOfIntervals = 0;
+    IntervalErrorSumSqSec = 0.0;
+    MaxIntervalErrorSec = 0.0;
+  }
+  void Add(const ClientStatistics& other)
+  {
+    NumberOfMessages += other.NumberOfMessages;
+    NumberOfBytes += other.NumberOfBytes;
+    SendStallSec += other.SendStallSec;
+    NumberOfIntervals += other.NumberOfIntervals;
+    IntervalErrorSumSqSec += other.IntervalErrorSumSqSec;
+    MaxIntervalErrorSec = std::max(MaxIntervalErrorSec, other.MaxIntervalErrorSec);
+  }
+  igtlUint64 NumberOfMessages;
+  igtlUint64 NumberOfBytes;
+  /*! Total time spent blocked in socket send calls */
+  double SendStallSec;
+  /*! Jitter: difference between the actual time between two sends and the requested send period */
+  igtlUint64 NumberOfIntervals;
+  double IntervalErrorSumSqSec;
+  double MaxIntervalErrorSec;
+};
+
+/*! Latency, sequence gap and reordering statistics computed by the receiver from latency probe messages */
+class LatencyStatistics
+{
+public:
+  LatencyStatistics(double binWidthSec, int numberOfBins)
+    : BinWidthSec(binWidthSec)
+    , Histogram(numberOfBins + 1, 0)
+    , ExpectedSequenceNumber(0)
+    , ExpectedSequenceNumberValid(false)
+  {
+    Reset();
+  }
+  void Reset()
+  {
+    std::fill(Histogram.begin(), Histogram.end(), 0);
+    NumberOfMessages = 0;
+    NumberOfGaps = 0;
+    NumberOfLostMessages = 0;
+    NumberOfReorderedMessages = 0;
+    LatencySumSec = 0.0;
+    MinLatencySec = 0.0;
+    MaxLatencySec = 0.0;
+  }
+  void AddMessage(double latencySec, igtlUint64 sequenceNumber);
+  /*! Returns the latency below which the given fraction of the messages were received (upper edge of the histogram bin) */
+  double GetLatencyPercentileSec(double fraction) const;
+  void Print(const char* label) const;
+
+protected:
+  double BinWidthSec;
+  /*! Last bin collects all latencies that do not fit into the regular bins */
+  std::vector<igtlUint64> Histogram;
+  igtlUint64 NumberOfMessages;
+  igtlUint64 NumberOfGaps;
+  igtlUint64 NumberOfLostMessages;
+  igtlUint64 NumberOfReorderedMessages;
+  double LatencySumSec;
+  double MinLatencySec;
+  double MaxLatencySec;
+  /*! Next expected sequence number, kept across Reset() so that gaps are detected at report boundaries */
+  igtlUint64 ExpectedSequenceNumber;
+  bool ExpectedSequenceNumberValid;
+};
 
-typedef struct
+/*! Pose of one tool on the precomputed benchmark trajectory */
+struct ToolPose
 {
-  int   nloop;
-  igtl::MutexLock::Pointer glock;
+  igtl::Matrix4x4 Matrix;
+};
+
+/*! Synthetic image streams sent to each client alongside the tracking data */
+struct ImageStreamSettings
+{
+  int NumberOfStreams;
+  int Size[3];
+  /*! Pixel type, one of igtl::ImageMessage::TYPE_... */
+  int ScalarType;
+  double FrameRateHz;
+};
+
+/*! Provides the messages of one stream. Only used by the stream thread. */
+class StreamMessageSource
+{
+public:
+  virtual ~StreamMessageSource() {}
+  /*! Updates the content of the message before it is packed and sent */
+  virtual void UpdateMessage() = 0;
+  virtual igtl::MessageBase* GetStreamMessage() = 0;
+};
+
+/*! Tracking data of all tools, either computed for each message or copied from the precomputed trajectory */
+class TrackingDataMessageSource : public StreamMessageSource
+{
+public:
+  TrackingDataMessageSource(int numberOfTools, const std::vector<ToolPose>* poseRing);
+  virtual void UpdateMessage();
+  virtual igtl::MessageBase* GetStreamMessage() { return TrackingMsg; }
+
+protected:
+  igtl::TrackingDataMessage::Pointer TrackingMsg;
+  const std::vector<ToolPose>* PoseRing;
+  int PoseIndex;
+  std::vector<float> Phi;
+  std::vector<float> Theta;
+};
+
+/*! Synthetic image frames. The message and its pixel buffer are allocated once and reused for all frames. */
+class ImageMessageSource : public StreamMessageSource
+{
+public:
+  ImageMessageSource(const std::string& deviceName, const ImageStreamSettings& settings);
+  virtual void UpdateMessage();
+  virtual igtl::MessageBase* GetStreamMessage() { return ImageMsg; }
+
+protected:
+  igtl::ImageMessage::Pointer ImageMsg;
+  int RowSizeBytes;
+  int NumberOfRows;
+  int FrameIndex;
+};
+
+/*!
+  State of one connected client. Each client has its own control thread and (while streaming) its own stream threads.
+  The socket is owned by the control thread: it is only closed after all the stream threads of the client have been joined,
+  so the stream threads can use it without any locking against the control thread.
+  Stream threads are stopped cooperatively: they check the stop flag and wait for the next send time on stopCondition,
+  so stopping a stream takes at most one send (which is bounded by the socket send timeout).
+*/
+struct ThreadData
+{
+  int   clientId;
   igtl::Socket::Pointer socket;
+  /*! Serializes the sends of the streams (tracking and images) of this client, clients do not share any lock */
+  std::mutex sendMutex;
+  /*! Send interval requested by the client in STT_TDATA (ms) */
   int   interval;
-  int   stop;
-} ThreadData;
+  /*! Send rate set on the command line (Hz), overrides the interval requested by the client if positive */
+  double sendRateHz;
+  int   numberOfTools;
+  double statsIntervalSec;
+  /*! Precomputed trajectory (pose ring) in benchmark mode, NULL if poses are computed for each message */
+  const std::vector<ToolPose>* poseRing;
+  /*! If nonzero then a send timestamp and a sequence number is embedded in each message */
+  int   latencyProbe;
+  ImageStreamSettings imageSettings;
+  std::atomic<bool> stop;
+  std::mutex stopMutex;
+  std::condition_variable stopCondition;
+  std::thread streamThread;
+  std::vector<std::thread> imageThreads;
+  /*! Set by the control thread when the client has disconnected and the thread can be joined */
+  std::atomic<bool> finished;
+  std::thread controlThread;
+};
+
+void  ClientThreadFunction(ThreadData* td);
+void  ThreadFunction(ThreadData* td);
+void  ImageThreadFunction(ThreadData* td, int streamIndex);
+void  RunStream(ThreadData* td, StreamClock::duration period, StreamMessageSource& source, const std::string& streamName);
+int   SendStreamMessage(igtl::Socket::Pointer& socket, igtl::MessageBase* message);
+void  UpdateTrackingData(igtl::TrackingDataMessage::Pointer& trackingMsg, std::vector<float>& phi, std::vector<float>& theta);
+void  UpdateTrackingDataFromPoseRing(igtl::TrackingDataMessage::Pointer& trackingMsg, const std::vector<ToolPose>& poseRing, int& poseIndex);
+void  InitializeTrajectory(std::vector<float>& phi, std::vector<float>& theta);
+void  AdvanceTrajectory(std::vector<float>& phi, std::vector<float>& theta);
+void  ComputePoseRing(int numberOfTools, int ringSize, std::vector<ToolPose>& poseRing);
+void  GetRandomTestMatrix(igtl::Matrix4x4& matrix, float phi, float theta);
+void  StampMessage(igtl::MessageBase* message, igtlUint64 sequenceNumber);
+double GetMonotonicTimeSec();
+int   RunLatencyReceiver(const std::string& hostname, int port, int resolutionMs, double durationSec, double statsIntervalSec, double binWidthSec, int numberOfBins);
+void  StartStreaming(ThreadData* td);
+void  StopStreaming(ThreadData* td);
+void  PrintStreamStatistics(const std::string& streamName, const ClientStatistics& stats, double elapsedSec, const char* label);
+std::string GetToolName(int toolIndex);
+int   GetImageScalarType(const std::string& scalarTypeStr);
 
 int main(int argc, char* argv[])
 {
   bool printHelp(false);
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
   int port = 18944;
+  int maxNumberOfClients = 16;
+  int numberOfTools = 3;
+  double sendRateHz = 0.0;
+  double statsIntervalSec = 5.0;
+  bool benchmark(false);
+  int poseRingSize = 1000;
+  bool latencyProbe(false);
+  bool latencyReceiver(false);
+  std::string hostname = "127.0.0.1";
+  double receiveDurationSec = 10.0;
+  double latencyBinWidthMs = 0.05;
+  int numberOfLatencyBins = 200;
+  int numberOfImageStreams = 0;
+  std::vector<int> imageSize;
+  std::string imageScalarTypeStr = "UCHAR";
+  double imageFrameRateHz = 30.0;
 
   vtksys::CommandLineArguments args;
   args.Initialize(argc, argv);
@@ -46,6 +254,22 @@ int main(int argc, char* argv[])
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   args.AddArgument("--port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &port, "Server port number");
+  args.AddArgument("--max-clients", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxNumberOfClients, "Maximum number of simultaneously connected clients (Default: 16)");
+  args.AddArgument("--tool-count", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tools sent in each TDATA message (Default: 3)");
+  args.AddArgument("--rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &sendRateHz, "Message send rate in Hz, up to several kHz. If not specified then the resolution requested by the client in STT_TDATA is used.");
+  args.AddArgument("--stats-interval", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &statsIntervalSec, "Time between per-client statistics reports in seconds, 0 to report only when the stream stops (Default: 5)");
+  args.AddArgument("--benchmark", vtksys::CommandLineArguments::NO_ARGUMENT, &benchmark, "Send poses from a precomputed trajectory, without any computation or console output per message");
+  args.AddArgument("--pose-ring-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &poseRingSize, "Number of precomputed poses per tool in benchmark mode (Default: 1000)");
+  args.AddArgument("--latency-probe", vtksys::CommandLineArguments::NO_ARGUMENT, &latencyProbe, "Embed a monotonic send timestamp (in the message header) and a sequence number (in the message metadata) in each message");
+  args.AddArgument("--latency-receiver", vtksys::CommandLineArguments::NO_ARGUMENT, &latencyReceiver, "Instead of serving data, connect to a server that runs with --latency-probe on the same host and report one-way latency, sequence gaps and reordering");
+  args.AddArgument("--host", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &hostname, "Server host name in latency receiver mode (Default: 127.0.0.1)");
+  args.AddArgument("--receive-duration", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &receiveDurationSec, "Duration of receiving in latency receiver mode in seconds (Default: 10)");
+  args.AddArgument("--latency-bin-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &latencyBinWidthMs, "Width of a latency histogram bin in ms (Default: 0.05)");
+  args.AddArgument("--latency-bins", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLatencyBins, "Number of latency histogram bins (Default: 200)");
+  args.AddArgument("--image-streams", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfImageStreams, "Number of synthetic IMAGE streams sent to each client alongside the tracking data (Default: 0)");
+  args.AddArgument("--image-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &imageSize, "Size of the synthetic image frames in pixels: columns rows [slices] (Default: 640 480 1)");
+  args.AddArgument("--image-scalar-type", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageScalarTypeStr, "Pixel type of the synthetic images: UCHAR, CHAR, USHORT, SHORT, UINT, INT or FLOAT (Default: UCHAR)");
+  args.AddArgument("--image-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageFrameRateHz, "Frame rate of each synthetic image stream in Hz (Default: 30)");
 
   if (!args.Parse())
   {
@@ -60,11 +284,43 @@ int main(int argc, char* argv[])
     exit(EXIT_SUCCESS);
   }
 
-  /*! igtl Factory for message sending */
-  vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory;
+  if (numberOfTools < 1 || maxNumberOfClients < 1 || poseRingSize < 1 || sendRateHz < 0)
+  {
+    std::cerr << "--tool-count, --max-clients and --pose-ring-size must be positive, --rate must not be negative" << std::endl;
+    exit(EXIT_FAILURE);
+  }
 
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
 
+  ImageStreamSettings imageSettings;
+  imageSettings.NumberOfStreams = numberOfImageStreams;
+  imageSettings.Size[0] = imageSize.size() > 0 ? imageSize[0] : 640;
+  imageSettings.Size[1] = imageSize.size() > 1 ? imageSize[1] : 480;
+  imageSettings.Size[2] = imageSize.size() > 2 ? imageSize[2] : 1;
+  imageSettings.ScalarType = GetImageScalarType(imageScalarTypeStr);
+  imageSettings.FrameRateHz = imageFrameRateHz;
+  if (imageSettings.NumberOfStreams < 0 || imageSettings.Size[0] < 1 || imageSettings.Size[1] < 1 || imageSettings.Size[2] < 1 || imageSettings.FrameRateHz <= 0)
+  {
+    std::cerr << "--image-streams must not be negative, --image-size and --image-rate must be positive" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (imageSettings.ScalarType < 0)
+  {
+    std::cerr << "Invalid --image-scalar-type: " << imageScalarTypeStr << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (latencyReceiver)
+  {
+    if (latencyBinWidthMs <= 0 || numberOfLatencyBins < 1)
+    {
+      std::cerr << "--latency-bin-width and --latency-bins must be positive" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    int resolutionMs = (sendRateHz > 0) ? std::max(1, static_cast<int>(1000.0 / sendRateHz)) : 10;
+    return RunLatencyReceiver(hostname, port, resolutionMs, receiveDurationSec, statsIntervalSec, latencyBinWidthMs / 1000.0, numberOfLatencyBins);
+  }
+
   igtl::ServerSocket::Pointer serverSocket;
   serverSocket = igtl::ServerSocket::New();
   int r = serverSocket->CreateServer(port);
@@ -75,102 +331,68 @@ int main(int argc, char* argv[])
     exit(0);
   }
 
-  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
-  igtl::MutexLock::Pointer glock = igtl::MutexLock::New();
-  ThreadData td;
+  // The trajectory is shared read-only by all clients
+  std::vector<ToolPose> poseRing;
+  if (benchmark)
+  {
+    ComputePoseRing(numberOfTools, poseRingSize, poseRing);
+  }
+
+  std::list<ThreadData*> clients;
+  int nextClientId = 0;
 
   while (1)
   {
+    //------------------------------------------------------------
+    // Release clients that have disconnected since the last iteration
+    for (std::list<ThreadData*>::iterator it = clients.begin(); it != clients.end();)
+    {
+      if ((*it)->finished)
+      {
+        (*it)->controlThread.join();
+        delete *it;
+        it = clients.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
     //------------------------------------------------------------
     // Waiting for Connection
-    int threadID = -1;
     igtl::Socket::Pointer socket;
     socket = serverSocket->WaitForConnection(1000);
 
-    if (socket.IsNotNull()) // if client connected
+    if (socket.IsNull())
     {
-      std::cerr << "A client is connected." << std::endl;
-
-      // Create a message buffer to receive header
-      igtl::MessageHeader::Pointer headerMsg = IgtlMessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
+      continue;
+    }
 
-      //------------------------------------------------------------
-      // loop
-      while (true)
-      {
-        // Receive generic header from the socket
-        bool timeout(false);
-        igtlUint64 rs = socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize(), timeout);
-        if (rs == 0)
-        {
-          if (threadID >= 0)
-          {
-            td.stop = 1;
-            threader->TerminateThread(threadID);
-            threadID = -1;
-          }
-          std::cerr << "Disconnecting the client." << std::endl;
-          td.socket = NULL;  // VERY IMPORTANT. Completely remove the instance.
-          socket->CloseSocket();
-          break;
-        }
-        if (rs != headerMsg->GetBufferSize())
-        {
-          continue;
-        }
-
-        // Deserialize the header
-        headerMsg->Unpack();
-
-        // Check data type and receive data body
-        igtl::MessageBase::Pointer bodyMsg = IgtlMessageFactory->CreateReceiveMessage(headerMsg);
-        if (bodyMsg.IsNull())
-        {
-          continue;
-        }
-        if (typeid(*bodyMsg) == typeid(igtl::StartTrackingDataMessage))
-        {
-          std::cerr << "Received a STT_TDATA message." << std::endl;
-
-          igtl::StartTrackingDataMessage::Pointer startTracking;
-          startTracking = igtl::StartTrackingDataMessage::New();
-          startTracking->SetMessageHeader(headerMsg);
-          startTracking->AllocateBuffer();
-
-          bool timeout(false);
-          igtlUint64 r2 = socket->Receive(startTracking->GetBufferBodyPointer(), startTracking->GetBufferBodySize(), timeout);
-          int c = startTracking->Unpack(1);
-          if (c & igtl::MessageHeader::UNPACK_BODY) // if CRC check is OK
-          {
-            td.interval = startTracking->GetResolution();
-            td.glock    = glock;
-            td.socket   = socket;
-            td.stop     = 0;
-            threadID    = threader->SpawnThread((igtl::ThreadFunctionType) &ThreadFunction, &td);
-          }
-        }
-        else if (typeid(*bodyMsg) == typeid(igtl::StopTrackingDataMessage))
-        {
-          socket->Skip(headerMsg->GetBodySizeToRead(), 0);
-          std::cerr << "Received a STP_TDATA message." << std::endl;
-          if (threadID >= 0)
-          {
-            td.stop  = 1;
-            threader->TerminateThread(threadID);
-            threadID = -1;
-            std::cerr << "Disconnecting the client." << std::endl;
-            td.socket = NULL;  // VERY IMPORTANT. Completely remove the instance.
-            socket->CloseSocket();
-          }
-          break;
-        }
-        else
-        {
-          std::cerr << "Receiving : " << headerMsg->GetMessageType() << std::endl;
-          socket->Skip(headerMsg->GetBodySizeToRead(), 0);
-        }
-      }
+    if (static_cast<int>(clients.size()) >= maxNumberOfClients)
+    {
+      std::cerr << "Maximum number of clients (" << maxNumberOfClients << ") reached, connection refused." << std::endl;
+      socket->CloseSocket();
+      continue;
     }
+
+    ThreadData* td = new ThreadData;
+    td->clientId         = nextClientId++;
+    td->socket           = socket;
+    td->interval         = 100;
+    td->sendRateHz       = sendRateHz;
+    td->numberOfTools    = numberOfTools;
+    td->statsIntervalSec = statsIntervalSec;
+    td->poseRing         = benchmark ? &poseRing : NULL;
+    td->latencyProbe     = latencyProbe ? 1 : 0;
+    td->imageSettings    = imageSettings;
+    td->stop             = true;
+    td->finished         = false;
+    // A receiver that stopped reading must not block the stream threads (and so stopping them) forever
+    socket->SetSendTimeout(SEND_TIMEOUT_MSEC);
+    std::cerr << "Client " << td->clientId << " is connected (" << clients.size() + 1 << " clients)." << std::endl;
+    td->controlThread    = std::thread(ClientThreadFunction, td);
+    clients.push_back(td);
   }
 
   //------------------------------------------------------------
@@ -178,109 +400,452 @@ int main(int argc, char* argv[])
   serverSocket->CloseSocket();
 }
 
-void* ThreadFunction(void* ptr)
+//------------------------------------------------------------
+// Receives the control messages of one client and starts/stops its streams
+void ClientThreadFunction(ThreadData* td)
 {
-  //------------------------------------------------------------
-  // Get thread information
-  igtl::MultiThreader::ThreadInfo* info =
-    static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  igtl::Socket::Pointer socket = td->socket;
 
-  ThreadData* td = static_cast<ThreadData*>(info->UserData);
+  // Create a message buffer to receive header
+  vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+  igtl::MessageHeader::Pointer headerMsg = IgtlMessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
 
   //------------------------------------------------------------
-  // Get user data
-  igtl::MutexLock::Pointer glock = td->glock;
-  long interval = td->interval;
-  std::cerr << "Interval = " << interval << " (ms)" << std::endl;
+  // loop
+  while (true)
+  {
+    // Receive generic header from the socket
+    bool timeout(false);
+    igtlUint64 rs = socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize(), timeout);
+    if (rs == 0)
+    {
+      StopStreaming(td);
+      std::cerr << "Disconnecting client " << td->clientId << "." << std::endl;
+      break;
+    }
+    if (rs != headerMsg->GetBufferSize())
+    {
+      continue;
+    }
 
-  igtl::Socket::Pointer& socket = td->socket;
+    // Deserialize the header
+    headerMsg->Unpack();
 
-  //------------------------------------------------------------
-  // Allocate TrackingData Message Class
-  //
-  // NOTE: TrackingDataElement class instances are allocated
-  //       before the loop starts to avoid reallocation
-  //       in each image transfer.
+    // Check data type and receive data body
+    igtl::MessageBase::Pointer bodyMsg = IgtlMessageFactory->CreateReceiveMessage(headerMsg);
+    if (bodyMsg.IsNull())
+    {
+      continue;
+    }
+    if (typeid(*bodyMsg) == typeid(igtl::StartTrackingDataMessage))
+    {
+      std::cerr << "Received a STT_TDATA message from client " << td->clientId << "." << std::endl;
+
+      igtl::StartTrackingDataMessage::Pointer startTracking;
+      startTracking = igtl::StartTrackingDataMessage::New();
+      startTracking->SetMessageHeader(headerMsg);
+      startTracking->AllocateBuffer();
+
+      bool timeout(false);
+      socket->Receive(startTracking->GetBufferBodyPointer(), startTracking->GetBufferBodySize(), timeout);
+      int c = startTracking->Unpack(1);
+      if (c & igtl::MessageHeader::UNPACK_BODY) // if CRC check is OK
+      {
+        StopStreaming(td);
+        td->interval = startTracking->GetResolution();
+        StartStreaming(td);
+      }
+    }
+    else if (typeid(*bodyMsg) == typeid(igtl::StopTrackingDataMessage))
+    {
+      socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      std::cerr << "Received a STP_TDATA message from client " << td->clientId << "." << std::endl;
+      // Keep the connection, the client may start streaming again
+      StopStreaming(td);
+    }
+    else
+    {
+      std::cerr << "Receiving : " << headerMsg->GetMessageType() << std::endl;
+      socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+    }
+  }
+
+  // All stream threads have been joined, nobody else uses the socket anymore
+  td->socket = NULL;  // VERY IMPORTANT. Completely remove the instance.
+  socket->CloseSocket();
+  td->finished = true;
+}
+
+//------------------------------------------------------------
+void StartStreaming(ThreadData* td)
+{
+  td->stop = false;
+  td->streamThread = std::thread(ThreadFunction, td);
+  for (int streamIndex = 0; streamIndex < td->imageSettings.NumberOfStreams; ++streamIndex)
+  {
+    td->imageThreads.push_back(std::thread(ImageThreadFunction, td, streamIndex));
+  }
+}
 
-  igtl::TrackingDataMessage::Pointer trackingMsg;
-  trackingMsg = igtl::TrackingDataMessage::New();
-  trackingMsg->SetDeviceName("Tracker");
+//------------------------------------------------------------
+void StopStreaming(ThreadData* td)
+{
+  if (!td->streamThread.joinable())
+  {
+    return;
+  }
+  {
+    // Set the flag while holding the mutex so that the notification cannot be missed
+    // by a stream thread that is just about to wait
+    std::lock_guard<std::mutex> lock(td->stopMutex);
+    td->stop = true;
+  }
+  td->stopCondition.notify_all();
+  td->streamThread.join();
+  for (std::vector<std::thread>::iterator it = td->imageThreads.begin(); it != td->imageThreads.end(); ++it)
+  {
+    it->join();
+  }
+  td->imageThreads.clear();
+}
 
-  igtl::TrackingDataElement::Pointer trackElement0;
-  trackElement0 = igtl::TrackingDataElement::New();
-  trackElement0->SetName("Probe");
-  trackElement0->SetType(igtl::TrackingDataElement::TYPE_6D);
+//------------------------------------------------------------
+void ThreadFunction(ThreadData* td)
+{
+  //------------------------------------------------------------
+  // Get user data
+  StreamClock::duration period = std::chrono::milliseconds(td->interval);
+  if (td->sendRateHz > 0)
+  {
+    period = std::chrono::duration_cast<StreamClock::duration>(std::chrono::duration<double>(1.0 / td->sendRateHz));
+    std::cerr << "Client " << td->clientId << ": rate = " << td->sendRateHz << " (Hz)" << std::endl;
+  }
+  else
+  {
+    std::cerr << "Client " << td->clientId << ": interval = " << td->interval << " (ms)" << std::endl;
+  }
+
+  TrackingDataMessageSource source(td->numberOfTools, td->poseRing);
+  std::ostringstream streamName;
+  streamName << "Client " << td->clientId << " TDATA";
+  RunStream(td, period, source, streamName.str());
+}
 
-  igtl::TrackingDataElement::Pointer trackElement1;
-  trackElement1 = igtl::TrackingDataElement::New();
-  trackElement1->SetName("Reference");
-  trackElement1->SetType(igtl::TrackingDataElement::TYPE_6D);
+//------------------------------------------------------------
+void ImageThreadFunction(ThreadData* td, int streamIndex)
+{
+  const StreamClock::duration period = std::chrono::duration_cast<StreamClock::duration>(std::chrono::duration<double>(1.0 / td->imageSettings.FrameRateHz));
+  std::ostringstream deviceName;
+  deviceName << "Image" << streamIndex;
+  ImageMessageSource source(deviceName.str(), td->imageSettings);
+  std::ostringstream streamName;
+  streamName << "Client " << td->clientId << " IMAGE " << deviceName.str();
+  RunStream(td, period, source, streamName.str());
+}
 
-  igtl::TrackingDataElement::Pointer trackElement2;
-  trackElement2 = igtl::TrackingDataElement::New();
-  trackElement2->SetName("Stylus");
-  trackElement2->SetType(igtl::TrackingDataElement::TYPE_6D);
+//------------------------------------------------------------
+// Sends the messages of one stream until streaming is stopped, pacing them with the given period
+void RunStream(ThreadData* td, StreamClock::duration period, StreamMessageSource& source, const std::string& streamName)
+{
+  igtl::Socket::Pointer socket = td->socket;
 
-  trackingMsg->AddTrackingDataElement(trackElement0);
-  trackingMsg->AddTrackingDataElement(trackElement1);
-  trackingMsg->AddTrackingDataElement(trackElement2);
+  igtl::MessageBase* message = source.GetStreamMessage();
+  if (td->latencyProbe)
+  {
+    // Metadata requires the version 2 header
+    message->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  }
+  igtlUint64 sequenceNumber = 0;
 
   //------------------------------------------------------------
   // Loop
+  ClientStatistics totalStats;
+  ClientStatistics intervalStats;
+  const StreamClock::time_point streamStartTime = StreamClock::now();
+  StreamClock::time_point intervalStartTime = streamStartTime;
+  StreamClock::time_point nextSendTime = streamStartTime;
+  StreamClock::time_point previousSendStartTime = streamStartTime;
+  const double periodSec = std::chrono::duration<double>(period).count();
+  bool firstMessage = true;
   while (!td->stop)
   {
-    glock->Lock();
-    SendTrackingData(socket, trackingMsg);
-    glock->Unlock();
-    igtl::Sleep(interval);
+    // Prepare the message before taking the lock, only the send itself needs to be serialized
+    source.UpdateMessage();
+    if (td->latencyProbe)
+    {
+      StampMessage(message, sequenceNumber++);
+    }
+    message->Pack();
+
+    const StreamClock::time_point sendStartTime = StreamClock::now();
+    int bytesSent = 0;
+    {
+      std::lock_guard<std::mutex> lock(td->sendMutex);
+      bytesSent = SendStreamMessage(socket, message);
+    }
+    const StreamClock::time_point sendEndTime = StreamClock::now();
+    if (bytesSent <= 0)
+    {
+      std::cerr << streamName << ": failed to send message, stop streaming." << std::endl;
+      break;
+    }
+
+    const double sendDurationSec = std::chrono::duration<double>(sendEndTime - sendStartTime).count();
+    intervalStats.NumberOfMessages++;
+    intervalStats.NumberOfBytes += bytesSent;
+    intervalStats.SendStallSec += sendDurationSec;
+    if (!firstMessage)
+    {
+      const double intervalErrorSec = std::chrono::duration<double>(sendStartTime - previousSendStartTime).count() - periodSec;
+      intervalStats.NumberOfIntervals++;
+      intervalStats.IntervalErrorSumSqSec += intervalErrorSec * intervalErrorSec;
+      intervalStats.MaxIntervalErrorSec = std::max(intervalStats.MaxIntervalErrorSec, fabs(intervalErrorSec));
+    }
+    previousSendStartTime = sendStartTime;
+    firstMessage = false;
+
+    const double intervalElapsedSec = std::chrono::duration<double>(sendEndTime - intervalStartTime).count();
+    if (td->statsIntervalSec > 0 && intervalElapsedSec >= td->statsIntervalSec)
+    {
+      PrintStreamStatistics(streamName, intervalStats, intervalElapsedSec, "");
+      totalStats.Add(intervalStats);
+      intervalStats.Reset();
+      intervalStartTime = sendEndTime;
+    }
+
+    // Pace on an absolute schedule so that the rate does not drift with the send time.
+    // If we fell behind by more than a period then do not try to catch up with a burst.
+    nextSendTime += period;
+    if (nextSendTime + period < sendEndTime)
+    {
+      nextSendTime = sendEndTime;
+    }
+    // Wake up immediately if the stream is stopped while waiting
+    std::unique_lock<std::mutex> lock(td->stopMutex);
+    td->stopCondition.wait_until(lock, nextSendTime, [td] { return td->stop.load(); });
   }
 
-  return NULL;
+  totalStats.Add(intervalStats);
+  PrintStreamStatistics(streamName, totalStats, std::chrono::duration<double>(StreamClock::now() - streamStartTime).count(), " total");
 }
 
+//------------------------------------------------------------
+void PrintStreamStatistics(const std::string& streamName, const ClientStatistics& stats, double elapsedSec, const char* label)
+{
+  if (elapsedSec <= 0)
+  {
+    return;
+  }
+  double rmsIntervalErrorSec = 0.0;
+  if (stats.NumberOfIntervals > 0)
+  {
+    rmsIntervalErrorSec = sqrt(stats.IntervalErrorSumSqSec / stats.NumberOfIntervals);
+  }
+  LOG_INFO(streamName << label << ": "
+           << stats.NumberOfMessages / elapsedSec << " msg/s, "
+           << stats.NumberOfBytes / elapsedSec / 1024.0 << " kB/s, "
+           << "send stall " << stats.SendStallSec * 1000.0 / elapsedSec << " ms/s, "
+           << "jitter rms " << rmsIntervalErrorSec * 1000.0 << " ms max " << stats.MaxIntervalErrorSec * 1000.0 << " ms "
+           << "(" << stats.NumberOfMessages << " messages in " << elapsedSec << " s)");
+}
 
-int SendTrackingData(igtl::Socket::Pointer& socket, igtl::TrackingDataMessage::Pointer& trackingMsg)
+//------------------------------------------------------------
+std::string GetToolName(int toolIndex)
 {
+  static const char* defaultToolNames[] = { "Probe", "Reference", "Stylus" };
+  if (toolIndex < 3)
+  {
+    return defaultToolNames[toolIndex];
+  }
+  std::ostringstream toolName;
+  toolName << "Tool" << toolIndex;
+  return toolName.str();
+}
 
-  static float phi0   = 0.0;
-  static float theta0 = 0.0;
-  static float phi1   = 1.1;
-  static float theta1 = 1.1;
-  static float phi2   = 2.5;
-  static float theta2 = 2.5;
+//------------------------------------------------------------
+// Returns the number of bytes sent, 0 if sending failed
+int SendStreamMessage(igtl::Socket::Pointer& socket, igtl::MessageBase* message)
+{
+  if (socket->Send(message->GetBufferPointer(), message->GetBufferSize()) == 0)
+  {
+    return 0;
+  }
+  return static_cast<int>(message->GetBufferSize());
+}
 
-  igtl::Matrix4x4 matrix;
-  igtl::TrackingDataElement::Pointer ptr;
+//------------------------------------------------------------
+TrackingDataMessageSource::TrackingDataMessageSource(int numberOfTools, const std::vector<ToolPose>* poseRing)
+  : PoseRing(poseRing)
+  , PoseIndex(0)
+  , Phi(numberOfTools)
+  , Theta(numberOfTools)
+{
+  //------------------------------------------------------------
+  // Allocate TrackingData Message Class
+  //
+  // NOTE: TrackingDataElement class instances are allocated
+  //       before the loop starts to avoid reallocation
+  //       in each image transfer.
+  TrackingMsg = igtl::TrackingDataMessage::New();
+  TrackingMsg->SetDeviceName("Tracker");
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    igtl::TrackingDataElement::Pointer trackElement;
+    trackElement = igtl::TrackingDataElement::New();
+    trackElement->SetName(GetToolName(toolIndex).c_str());
+    trackElement->SetType(igtl::TrackingDataElement::TYPE_6D);
+    TrackingMsg->AddTrackingDataElement(trackElement);
+  }
+  // Motion phases are kept per stream so that concurrent clients do not share state
+  InitializeTrajectory(Phi, Theta);
+}
+
+//------------------------------------------------------------
+void TrackingDataMessageSource::UpdateMessage()
+{
+  if (PoseRing != NULL)
+  {
+    UpdateTrackingDataFromPoseRing(TrackingMsg, *PoseRing, PoseIndex);
+  }
+  else
+  {
+    UpdateTrackingData(TrackingMsg, Phi, Theta);
+  }
+}
 
-  // Channel 0
-  trackingMsg->GetTrackingDataElement(0, ptr);
-  GetRandomTestMatrix(matrix, phi0, theta0);
-  ptr->SetMatrix(matrix);
+//------------------------------------------------------------
+ImageMessageSource::ImageMessageSource(const std::string& deviceName, const ImageStreamSettings& settings)
+  : FrameIndex(0)
+{
+  ImageMsg = igtl::ImageMessage::New();
+  ImageMsg->SetDeviceName(deviceName.c_str());
+  ImageMsg->SetDimensions(settings.Size[0], settings.Size[1], settings.Size[2]);
+  ImageMsg->SetSpacing(0.2f, 0.2f, 1.0f);
+  ImageMsg->SetScalarType(settings.ScalarType);
+  ImageMsg->SetNumComponents(1);
+  ImageMsg->SetEndian(igtl::ImageMessage::ENDIAN_LITTLE);
+  igtl::Matrix4x4 identity;
+  igtl::IdentityMatrix(identity);
+  ImageMsg->SetMatrix(identity);
+  // The pixel data is part of the message buffer, it is allocated once and updated in place for each frame
+  ImageMsg->AllocateScalars();
 
-  // Channel 1
-  trackingMsg->GetTrackingDataElement(1, ptr);
-  GetRandomTestMatrix(matrix, phi1, theta1);
-  ptr->SetMatrix(matrix);
+  unsigned char* pixels = static_cast<unsigned char*>(ImageMsg->GetScalarPointer());
+  const int imageSizeBytes = ImageMsg->GetImageSize();
+  for (int i = 0; i < imageSizeBytes; ++i)
+  {
+    pixels[i] = static_cast<unsigned char>(i);
+  }
+  RowSizeBytes = imageSizeBytes / (settings.Size[1] * settings.Size[2]);
+  NumberOfRows = settings.Size[1] * settings.Size[2];
+}
 
-  // Channel 2
-  trackingMsg->GetTrackingDataElement(2, ptr);
-  GetRandomTestMatrix(matrix, phi2, theta2);
-  ptr->SetMatrix(matrix);
+//------------------------------------------------------------
+// Moves a bright line over the image so that consecutive frames differ, touching only one row per frame
+void ImageMessageSource::UpdateMessage()
+{
+  unsigned char* pixels = static_cast<unsigned char*>(ImageMsg->GetScalarPointer());
+  const int previousRow = FrameIndex % NumberOfRows;
+  const int currentRow = (FrameIndex + 1) % NumberOfRows;
+  for (int i = previousRow * RowSizeBytes; i < (previousRow + 1) * RowSizeBytes; ++i)
+  {
+    pixels[i] = static_cast<unsigned char>(i);
+  }
+  memset(pixels + currentRow * RowSizeBytes, 0xff, RowSizeBytes);
+  FrameIndex++;
+}
+
+//------------------------------------------------------------
+// Returns the igtl::ImageMessage pixel type corresponding to the name, -1 if the name is not recognized
+int GetImageScalarType(const std::string& scalarTypeStr)
+{
+  if (STRCASECMP(scalarTypeStr.c_str(), "UCHAR") == 0) { return igtl::ImageMessage::TYPE_UINT8; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "CHAR") == 0) { return igtl::ImageMessage::TYPE_INT8; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "USHORT") == 0) { return igtl::ImageMessage::TYPE_UINT16; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "SHORT") == 0) { return igtl::ImageMessage::TYPE_INT16; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "UINT") == 0) { return igtl::ImageMessage::TYPE_UINT32; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "INT") == 0) { return igtl::ImageMessage::TYPE_INT32; }
+  if (STRCASECMP(scalarTypeStr.c_str(), "FLOAT") == 0) { return igtl::ImageMessage::TYPE_FLOAT32; }
+  return -1;
+}
+
+//------------------------------------------------------------
+// Computes the next pose of each tool
+void UpdateTrackingData(igtl::TrackingDataMessage::Pointer& trackingMsg, std::vector<float>& phi, std::vector<float>& theta)
+{
+  igtl::Matrix4x4 matrix;
+  igtl::TrackingDataElement::Pointer ptr;
 
-  trackingMsg->Pack();
-  socket->Send(trackingMsg->GetBufferPointer(), trackingMsg->GetBufferSize());
+  const bool printMatrix = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
+  for (int toolIndex = 0; toolIndex < trackingMsg->GetNumberOfTrackingDataElements(); ++toolIndex)
+  {
+    trackingMsg->GetTrackingDataElement(toolIndex, ptr);
+    GetRandomTestMatrix(matrix, phi[toolIndex], theta[toolIndex]);
+    ptr->SetMatrix(matrix);
+    if (printMatrix)
+    {
+      igtl::PrintMatrix(matrix);
+    }
+  }
+  AdvanceTrajectory(phi, theta);
+}
 
-  phi0 += 0.1;
-  phi1 += 0.2;
-  phi2 += 0.3;
-  theta0 += 0.2;
-  theta1 += 0.1;
-  theta2 += 0.05;
+//------------------------------------------------------------
+// Copies the next poses of the precomputed trajectory into the message.
+// The message size does not change, so packing reuses the already allocated message buffer.
+void UpdateTrackingDataFromPoseRing(igtl::TrackingDataMessage::Pointer& trackingMsg, const std::vector<ToolPose>& poseRing, int& poseIndex)
+{
+  const int numberOfTools = trackingMsg->GetNumberOfTrackingDataElements();
+  const int ringSize = static_cast<int>(poseRing.size()) / numberOfTools;
+  igtl::TrackingDataElement::Pointer ptr;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    trackingMsg->GetTrackingDataElement(toolIndex, ptr);
+    // SetMatrix takes a non-const matrix
+    ptr->SetMatrix(const_cast<igtl::Matrix4x4&>(poseRing[poseIndex * numberOfTools + toolIndex].Matrix));
+  }
+  poseIndex = (poseIndex + 1) % ringSize;
+}
 
-  return 0;
+//------------------------------------------------------------
+void InitializeTrajectory(std::vector<float>& phi, std::vector<float>& theta)
+{
+  // The first three tools start from the same angles as the original fixed Probe/Reference/Stylus tools,
+  // additional tools repeat the pattern with an offset so that they do not overlap
+  static const float initialAngles[3] = { 0.0f, 1.1f, 2.5f };
+  for (size_t toolIndex = 0; toolIndex < phi.size(); ++toolIndex)
+  {
+    phi[toolIndex] = theta[toolIndex] = initialAngles[toolIndex % 3] + 0.4f * (toolIndex / 3);
+  }
 }
 
+//------------------------------------------------------------
+void AdvanceTrajectory(std::vector<float>& phi, std::vector<float>& theta)
+{
+  for (size_t toolIndex = 0; toolIndex < phi.size(); ++toolIndex)
+  {
+    phi[toolIndex] += 0.1 * (toolIndex % 3 + 1);
+    theta[toolIndex] += 0.2 / (1 << (toolIndex % 3));
+  }
+}
 
+//------------------------------------------------------------
+// Precomputes ringSize poses for each tool, stored as [poseIndex * numberOfTools + toolIndex]
+void ComputePoseRing(int numberOfTools, int ringSize, std::vector<ToolPose>& poseRing)
+{
+  std::vector<float> phi(numberOfTools);
+  std::vector<float> theta(numberOfTools);
+  InitializeTrajectory(phi, theta);
+  poseRing.resize(numberOfTools * ringSize);
+  for (int poseIndex = 0; poseIndex < ringSize; ++poseIndex)
+  {
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      GetRandomTestMatrix(poseRing[poseIndex * numberOfTools + toolIndex].Matrix, phi[toolIndex], theta[toolIndex]);
+    }
+    AdvanceTrajectory(phi, theta);
+  }
+}
 
 //------------------------------------------------------------
 // Function to generate random matrix.
@@ -308,8 +873,227 @@ void GetRandomTestMatrix(igtl::Matrix4x4& matrix, float phi, float theta)
   matrix[0][3] = position[0];
   matrix[1][3] = position[1];
   matrix[2][3] = position[2];
+}
+
+
+//------------------------------------------------------------
+// Seconds of a clock that is monotonic and shared by all processes on the host,
+// so it can be compared between the sender and a receiver on the loopback interface
+double GetMonotonicTimeSec()
+{
+  return std::chrono::duration<double>(StreamClock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------
+// Sets the send timestamp in the header and the sequence number in the metadata.
+// The sequence number is zero-padded to keep the message size (and so the message buffer) constant.
+void StampMessage(igtl::MessageBase* message, igtlUint64 sequenceNumber)
+{
+  std::ostringstream sequenceNumberStr;
+  sequenceNumberStr << std::setw(20) << std::setfill('0') << sequenceNumber;
+  message->SetMetaDataElement(SEQUENCE_NUMBER_METADATA_KEY, IANA_TYPE_US_ASCII, sequenceNumberStr.str());
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->SetTime(GetMonotonicTimeSec());
+  message->SetTimeStamp(timestamp);
+}
+
+//------------------------------------------------------------
+void LatencyStatistics::AddMessage(double latencySec, igtlUint64 sequenceNumber)
+{
+  if (NumberOfMessages == 0 || latencySec < MinLatencySec)
+  {
+    MinLatencySec = latencySec;
+  }
+  if (NumberOfMessages == 0 || latencySec > MaxLatencySec)
+  {
+    MaxLatencySec = latencySec;
+  }
+  NumberOfMessages++;
+  LatencySumSec += latencySec;
+
+  size_t binIndex = Histogram.size() - 1;
+  if (latencySec >= 0 && latencySec / BinWidthSec < Histogram.size() - 1)
+  {
+    binIndex = static_cast<size_t>(latencySec / BinWidthSec);
+  }
+  Histogram[binIndex]++;
+
+  if (ExpectedSequenceNumberValid)
+  {
+    if (sequenceNumber < ExpectedSequenceNumber)
+    {
+      // Older than a message that has been already received
+      NumberOfReorderedMessages++;
+      return;
+    }
+    if (sequenceNumber > ExpectedSequenceNumber)
+    {
+      NumberOfGaps++;
+      NumberOfLostMessages += sequenceNumber - ExpectedSequenceNumber;
+    }
+  }
+  ExpectedSequenceNumber = sequenceNumber + 1;
+  ExpectedSequenceNumberValid = true;
+}
+
+//------------------------------------------------------------
+double LatencyStatistics::GetLatencyPercentileSec(double fraction) const
+{
+  igtlUint64 count = 0;
+  for (size_t binIndex = 0; binIndex + 1 < Histogram.size(); ++binIndex)
+  {
+    count += Histogram[binIndex];
+    if (count >= fraction * NumberOfMessages)
+    {
+      return (binIndex + 1) * BinWidthSec;
+    }
+  }
+  return MaxLatencySec;
+}
 
-  igtl::PrintMatrix(matrix);
+//------------------------------------------------------------
+void LatencyStatistics::Print(const char* label) const
+{
+  if (NumberOfMessages == 0)
+  {
+    LOG_INFO("Latency" << label << ": no messages received");
+    return;
+  }
+  LOG_INFO("Latency" << label << ": "
+           << "mean " << LatencySumSec / NumberOfMessages * 1000.0 << " ms, "
+           << "min " << MinLatencySec * 1000.0 << " ms, "
+           << "p50 " << GetLatencyPercentileSec(0.50) * 1000.0 << " ms, "
+           << "p99 " << GetLatencyPercentileSec(0.99) * 1000.0 << " ms, "
+           << "max " << MaxLatencySec * 1000.0 << " ms "
+           << "(" << NumberOfMessages << " messages, "
+           << NumberOfGaps << " gaps with " << NumberOfLostMessages << " lost messages, "
+           << NumberOfReorderedMessages << " reordered)");
+  for (size_t binIndex = 0; binIndex < Histogram.size(); ++binIndex)
+  {
+    if (Histogram[binIndex] == 0)
+    {
+      continue;
+    }
+    if (binIndex + 1 < Histogram.size())
+    {
+      LOG_DEBUG("  [" << binIndex * BinWidthSec * 1000.0 << ", " << (binIndex + 1) * BinWidthSec * 1000.0 << ") ms: " << Histogram[binIndex]);
+    }
+    else
+    {
+      LOG_DEBUG("  >= " << binIndex * BinWidthSec * 1000.0 << " ms: " << Histogram[binIndex]);
+    }
+  }
 }
 
+//------------------------------------------------------------
+// Connects to a server running with --latency-probe, requests tracking data
+// and computes latency statistics from the embedded send timestamps and sequence numbers
+int RunLatencyReceiver(const std::string& hostname, int port, int resolutionMs, double durationSec, double statsIntervalSec, double binWidthSec, int numberOfBins)
+{
+  igtl::ClientSocket::Pointer socket = igtl::ClientSocket::New();
+  if (socket->ConnectToServer(hostname.c_str(), port) != 0)
+  {
+    LOG_ERROR("Cannot connect to the server at " << hostname << ":" << port);
+    return EXIT_FAILURE;
+  }
+  // Do not block past the end of the receive duration if the server stops sending
+  socket->SetReceiveTimeout(1000);
+
+  igtl::StartTrackingDataMessage::Pointer startTracking = igtl::StartTrackingDataMessage::New();
+  startTracking->SetDeviceName("LatencyReceiver");
+  startTracking->SetResolution(resolutionMs);
+  startTracking->Pack();
+  socket->Send(startTracking->GetBufferPointer(), startTracking->GetBufferSize());
+
+  LatencyStatistics totalStats(binWidthSec, numberOfBins);
+  LatencyStatistics intervalStats(binWidthSec, numberOfBins);
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  igtl::TrackingDataMessage::Pointer trackingMsg = igtl::TrackingDataMessage::New();
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+
+  const double startTimeSec = GetMonotonicTimeSec();
+  double intervalStartTimeSec = startTimeSec;
+  int numberOfMessagesWithoutSequenceNumber = 0;
+  while (GetMonotonicTimeSec() - startTimeSec < durationSec)
+  {
+    headerMsg->InitBuffer();
+    bool timeout(false);
+    igtlUint64 rs = socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize(), timeout);
+    // The receive time is taken as soon as the header has arrived
+    const double receiveTimeSec = GetMonotonicTimeSec();
+    if (timeout)
+    {
+      continue;
+    }
+    if (rs == 0)
+    {
+      LOG_ERROR("Connection closed by the server");
+      break;
+    }
+    if (rs != headerMsg->GetBufferSize())
+    {
+      continue;
+    }
+    headerMsg->Unpack();
+    if (strcmp(headerMsg->GetDeviceType(), "TDATA") != 0)
+    {
+      socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      continue;
+    }
+
+    trackingMsg->SetMessageHeader(headerMsg);
+    trackingMsg->AllocateBuffer();
+    rs = socket->Receive(trackingMsg->GetBufferBodyPointer(), trackingMsg->GetBufferBodySize(), timeout);
+    if (rs != trackingMsg->GetBufferBodySize())
+    {
+      // The rest of the stream cannot be interpreted after a partially received message
+      LOG_ERROR("Incomplete message body received (" << rs << " of " << trackingMsg->GetBufferBodySize() << " bytes)");
+      break;
+    }
+    if (!(trackingMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+    {
+      LOG_DEBUG("Unable to unpack tracking data message, skipped");
+      continue;
+    }
+
+    std::string sequenceNumberStr;
+    if (!trackingMsg->GetMetaDataElement(SEQUENCE_NUMBER_METADATA_KEY, sequenceNumberStr))
+    {
+      // Without the probe metadata the header timestamp is not from GetMonotonicTimeSec, so no latency can be computed
+      if (numberOfMessagesWithoutSequenceNumber++ == 0)
+      {
+        LOG_WARNING("Message without " << SEQUENCE_NUMBER_METADATA_KEY << " metadata received, is the server running with --latency-probe? Such messages are ignored.");
+      }
+      continue;
+    }
+    igtlUint64 sequenceNumber = std::strtoull(sequenceNumberStr.c_str(), NULL, 10);
 
+    // The send and receive times are both from the steady clock, which is only comparable between
+    // processes of the same host, therefore the receiver must run on the same host as the server
+    headerMsg->GetTimeStamp(timestamp);
+    const double latencySec = receiveTimeSec - timestamp->GetTimeStamp();
+    totalStats.AddMessage(latencySec, sequenceNumber);
+    intervalStats.AddMessage(latencySec, sequenceNumber);
+
+    if (statsIntervalSec > 0 && receiveTimeSec - intervalStartTimeSec >= statsIntervalSec)
+    {
+      intervalStats.Print("");
+      intervalStats.Reset();
+      intervalStartTimeSec = receiveTimeSec;
+    }
+  }
+
+  igtl::StopTrackingDataMessage::Pointer stopTracking = igtl::StopTrackingDataMessage::New();
+  stopTracking->SetDeviceName("LatencyReceiver");
+  stopTracking->Pack();
+  socket->Send(stopTracking->GetBufferPointer(), stopTracking->GetBufferSize());
+  socket->CloseSocket();
+
+  if (numberOfMessagesWithoutSequenceNumber > 0)
+  {
+    LOG_WARNING(numberOfMessagesWithoutSequenceNumber << " messages without " << SEQUENCE_NUMBER_METADATA_KEY << " metadata were ignored");
+  }
+  totalStats.Print(" total");
+  return EXIT_SUCCESS;
+}
@@ -22,11 +22,20 @@
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
 
+#ifdef PLUS_USE_OpenIGTLink
+// OpenIGTLink includes
+#include <igtlClientSocket.h>
+#include <igtlMessageHeader.h>
+#include <igtlTrackingDataMessage.h>
+#include <igtlTransformMessage.h>
+#endif
+
 // VTK includes
 #include <vtkActor.h>
 #include <vtkAppendPolyData.h>
 #include <vtkCamera.h>
 #include <vtkCellArray.h>
+#include <vtkContourFilter.h>
 #include <vtkGlyph3D.h>
 #include <vtkLineSource.h>
 #include <vtkMatrix4x4.h>
@@ -39,13 +48,1208 @@
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
+#include <vtkReverseSense.h>
 #include <vtkSTLWriter.h>
 #include <vtkSphereSource.h>
+#include <vtkSurfaceReconstructionFilter.h>
+#include <vtkTimerLog.h>
 #include <vtkTriangleFilter.h>
 #include <vtkTubeFilter.h>
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/Glob.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+
+//-----------------------------------------------------------------------------
+/*!
+  Reads the transforms of a sequence file frame by frame, directly from the file header.
+  Frame fields of MetaImage (.mha, .mhd) and NRRD (.nrrd, .nhdr) sequence files are stored in the text
+  header before the image data, therefore transforms can be read without reading, decoding, or allocating
+  any image data. Only one frame is kept in memory at a time.
+*/
+class SequenceTransformReader
+{
+public:
+  SequenceTransformReader()
+    : Nrrd(false)
+    , EndOfHeader(false)
+    , HasPendingField(false)
+    , PendingFrameIndex(-1)
+  {
+  }
+
+  /*! Returns true if the transforms can be read from the header of the file */
+  static bool CanReadFile(const std::string& fileName);
+
+  PlusStatus Open(const std::string& fileName);
+
+  /*!
+    Passes each field of the next frame to fieldHandler(const std::string& fieldName, const std::string& fieldValue).
+    Returns PLUS_FAIL if there are no more frames.
+  */
+  template<class FieldHandler>
+  PlusStatus ReadNextFrame(FieldHandler fieldHandler)
+  {
+    bool frameStarted = false;
+    int frameIndex = -1;
+    while (this->HasPendingField || this->ReadNextFrameField(this->PendingFrameIndex, this->PendingFieldName, this->PendingFieldValue) == PLUS_SUCCESS)
+    {
+      this->HasPendingField = true;
+      if (frameStarted && this->PendingFrameIndex != frameIndex)
+      {
+        // The field belongs to the next frame, keep it for the next call
+        return PLUS_SUCCESS;
+      }
+      frameStarted = true;
+      frameIndex = this->PendingFrameIndex;
+      this->HasPendingField = false;
+      fieldHandler(this->PendingFieldName, this->PendingFieldValue);
+    }
+    return frameStarted ? PLUS_SUCCESS : PLUS_FAIL;
+  }
+
+protected:
+  /*!
+    Reads the next per-frame field from the header. Returns PLUS_FAIL at the end of the header.
+    The line buffer and the output strings are reused, so no memory is allocated once they are large enough.
+  */
+  PlusStatus ReadNextFrameField(int& frameIndex, std::string& fieldName, std::string& fieldValue);
+
+  std::ifstream File;
+  bool Nrrd;
+  bool EndOfHeader;
+  std::string Line;
+
+  /*! The first field of the next frame, which has already been read from the file */
+  bool HasPendingField;
+  int PendingFrameIndex;
+  std::string PendingFieldName;
+  std::string PendingFieldValue;
+};
+
+/*! Name prefix of the per-frame fields in the sequence file header, followed by the frame index and an underscore */
+static const std::string SEQUENCE_FRAME_FIELD_PREFIX = "Seq_Frame";
+
+//-----------------------------------------------------------------------------
+bool SequenceTransformReader::CanReadFile(const std::string& fileName)
+{
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(fileName));
+  return extension == ".mha" || extension == ".mhd" || extension == ".nrrd" || extension == ".nhdr";
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus SequenceTransformReader::Open(const std::string& fileName)
+{
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(fileName));
+  this->Nrrd = (extension == ".nrrd" || extension == ".nhdr");
+  this->EndOfHeader = false;
+  this->HasPendingField = false;
+  this->File.open(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!this->File.is_open())
+  {
+    LOG_ERROR("Failed to open sequence file: " << fileName);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Assigns the part of str between begin and end to result, without leading and trailing spaces
+void AssignTrimmed(const std::string& str, std::string::size_type begin, std::string::size_type end, std::string& result)
+{
+  while (begin < end && isspace(static_cast<unsigned char>(str[begin])))
+  {
+    ++begin;
+  }
+  while (end > begin && isspace(static_cast<unsigned char>(str[end - 1])))
+  {
+    --end;
+  }
+  result.assign(str, begin, end - begin);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus SequenceTransformReader::ReadNextFrameField(int& frameIndex, std::string& fieldName, std::string& fieldValue)
+{
+  std::string& line = this->Line;
+  while (!this->EndOfHeader && std::getline(this->File, line))
+  {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+    {
+      line.erase(line.size() - 1);
+    }
+    if (this->Nrrd ? line.empty() : line.compare(0, 15, "ElementDataFile") == 0)
+    {
+      // Image data follows, there are no more fields
+      break;
+    }
+    if (line.compare(0, SEQUENCE_FRAME_FIELD_PREFIX.size(), SEQUENCE_FRAME_FIELD_PREFIX) != 0)
+    {
+      continue;
+    }
+    // MetaImage fields are stored as "name = value", NRRD key/value pairs as "name:=value"
+    std::string::size_type separatorPos = this->Nrrd ? line.find(":=") : line.find('=');
+    std::string::size_type indexEndPos = line.find('_', SEQUENCE_FRAME_FIELD_PREFIX.size());
+    if (separatorPos == std::string::npos || indexEndPos == std::string::npos || indexEndPos > separatorPos)
+    {
+      LOG_WARNING("Invalid frame field in sequence file header: " << line);
+      continue;
+    }
+    frameIndex = atoi(line.c_str() + SEQUENCE_FRAME_FIELD_PREFIX.size());
+    AssignTrimmed(line, indexEndPos + 1, separatorPos, fieldName);
+    AssignTrimmed(line, separatorPos + (this->Nrrd ? 2 : 1), line.size(), fieldValue);
+    return PLUS_SUCCESS;
+  }
+  this->EndOfHeader = true;
+  return PLUS_FAIL;
+}
+
+//-----------------------------------------------------------------------------
+/*!
+  Computes a fixed transform (e.g., StylusToReference) from the frame transforms of each frame.
+  The path between the two coordinate frames is resolved only once, from the transform names of a frame and the
+  coordinate definitions of the configuration, and the constant transforms along the path are taken from the
+  transform repository at that time. Evaluating a frame then only parses and multiplies the few frame transforms
+  that are on the path, without rebuilding the transform repository and without heap allocation.
+*/
+class TransformPathEvaluator
+{
+public:
+  /*!
+    Finds the path from the From to the To coordinate frame of transformName.
+    Frame transforms (changing in every frame) are taken from frameTransformNames, which are the transform names of the
+    first frame and are used for all frames. Constant transforms are taken from the CoordinateDefinitions element of the configuration.
+    Fails if the transform repository cannot compute transformName from these transforms. Previously such an input was
+    processed frame by frame and resulted in an empty point set; now it is reported as an error before any frame is processed.
+    If silent is true, a missing path is only logged at debug level (e.g., while waiting for transforms in a live stream).
+  */
+  PlusStatus Resolve(const igsioTransformName& transformName, const std::vector<igsioTransformName>& frameTransformNames,
+                     vtkXMLDataElement* configRootElement, vtkIGSIOTransformRepository* transformRepository, bool silent = false);
+
+  /*! Invalidates all frame transforms. To be called before the fields of a new frame are set. */
+  void ClearFrame();
+
+  /*! Sets a frame transform or transform status from a sequence file field. Fields that are not on the path are ignored. */
+  void SetFrameField(const std::string& fieldName, const std::string& fieldValue);
 
+  /*! Returns true if the sequence file field is a frame transform or transform status on the path */
+  bool IsFrameFieldOnPath(const std::string& fieldName) const;
+
+  /*! Sets a valid frame transform, e.g., received from a tracker stream. Transforms that are not on the path are ignored. */
+  void SetFrameTransform(const std::string& transformName, const double matrix[16]);
+
+  /*! Sets all frame transforms that are on the path from a tracked frame */
+  void SetFrameFields(igsioTrackedFrame& trackedFrame);
+
+  /*! Computes the transform for the current frame. Returns false if any frame transform on the path is missing or invalid. */
+  bool Evaluate(double matrix[16]) const;
+
+protected:
+  struct FrameInput
+  {
+    igsioTransformName Name;
+    std::string TransformName;
+    std::string TransformFieldName;
+    std::string StatusFieldName;
+    double Matrix[16];
+    bool Valid;
+    bool StatusOk;
+  };
+
+  struct PathStep
+  {
+    /*! Index of the frame transform in FrameInputs, -1 for a constant transform */
+    int FrameInputIndex;
+    /*! The frame transform has to be inverted (constant transforms are stored inverted already) */
+    bool Inverse;
+    double ConstantMatrix[16];
+  };
+
+  std::vector<FrameInput> FrameInputs;
+  std::vector<PathStep> Path;
+};
+
+//-----------------------------------------------------------------------------
+PlusStatus TransformPathEvaluator::Resolve(const igsioTransformName& transformName, const std::vector<igsioTransformName>& frameTransformNames,
+    vtkXMLDataElement* configRootElement, vtkIGSIOTransformRepository* transformRepository, bool silent /*=false*/)
+{
+  // Check with the transform repository that the transform can be computed from the frame transforms and the
+  // constant transforms of the configuration. A copy is used, so the repository remains unchanged and can be shared.
+  vtkSmartPointer<vtkIGSIOTransformRepository> frameTransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  frameTransformRepository->DeepCopy(transformRepository);
+  vtkSmartPointer<vtkMatrix4x4> identityMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (std::vector<igsioTransformName>::const_iterator nameIt = frameTransformNames.begin(); nameIt != frameTransformNames.end(); ++nameIt)
+  {
+    frameTransformRepository->SetTransform(*nameIt, identityMatrix, TOOL_OK);
+  }
+  if (frameTransformRepository->IsExistingTransform(transformName) != IGSIO_SUCCESS)
+  {
+    if (silent)
+    {
+      LOG_DEBUG("No transform path found from " << transformName.From() << " to " << transformName.To());
+    }
+    else
+    {
+      LOG_ERROR("No transform path found from " << transformName.From() << " to " << transformName.To());
+    }
+    return PLUS_FAIL;
+  }
+
+  // Edges of the coordinate frame graph. Coordinate frame names are normalized by igsioTransformName, as in the repository.
+  struct Edge
+  {
+    std::string From;
+    std::string To;
+    int FrameInputIndex;
+  };
+  std::vector<Edge> edges;
+  for (std::vector<igsioTransformName>::const_iterator nameIt = frameTransformNames.begin(); nameIt != frameTransformNames.end(); ++nameIt)
+  {
+    Edge edge = { nameIt->From(), nameIt->To(), static_cast<int>(edges.size()) };
+    edges.push_back(edge);
+  }
+  vtkXMLDataElement* coordinateDefinitions = (configRootElement != NULL) ? configRootElement->FindNestedElementWithName("CoordinateDefinitions") : NULL;
+  if (coordinateDefinitions != NULL)
+  {
+    for (int i = 0; i < coordinateDefinitions->GetNumberOfNestedElements(); ++i)
+    {
+      vtkXMLDataElement* transformElement = coordinateDefinitions->GetNestedElement(i);
+      if (STRCASECMP(transformElement->GetName(), "Transform") != 0 || transformElement->GetAttribute("From") == NULL || transformElement->GetAttribute("To") == NULL)
+      {
+        continue;
+      }
+      igsioTransformName constantTransformName(transformElement->GetAttribute("From"), transformElement->GetAttribute("To"));
+      Edge edge = { constantTransformName.From(), constantTransformName.To(), -1 };
+      edges.push_back(edge);
+    }
+  }
+
+  // Breadth-first search from the From coordinate frame. For each reached coordinate frame
+  // the edge and the coordinate frame through which it was reached are stored.
+  std::vector<std::string> reachedFrames(1, transformName.From());
+  std::vector<int> reachedThroughEdge(1, -1);
+  std::vector<int> reachedFromFrame(1, -1);
+  for (size_t frameIndex = 0; frameIndex < reachedFrames.size(); ++frameIndex)
+  {
+    for (size_t edgeIndex = 0; edgeIndex < edges.size(); ++edgeIndex)
+    {
+      const std::string* nextFrame = NULL;
+      if (edges[edgeIndex].From == reachedFrames[frameIndex])
+      {
+        nextFrame = &edges[edgeIndex].To;
+      }
+      else if (edges[edgeIndex].To == reachedFrames[frameIndex])
+      {
+        nextFrame = &edges[edgeIndex].From;
+      }
+      if (nextFrame == NULL || std::find(reachedFrames.begin(), reachedFrames.end(), *nextFrame) != reachedFrames.end())
+      {
+        continue;
+      }
+      reachedFrames.push_back(*nextFrame);
+      reachedThroughEdge.push_back(static_cast<int>(edgeIndex));
+      reachedFromFrame.push_back(static_cast<int>(frameIndex));
+    }
+  }
+  std::vector<std::string>::iterator toFrameIt = std::find(reachedFrames.begin(), reachedFrames.end(), transformName.To());
+  if (toFrameIt == reachedFrames.end())
+  {
+    LOG_ERROR("Transform path from " << transformName.From() << " to " << transformName.To() << " could not be resolved");
+    return PLUS_FAIL;
+  }
+
+  // Collect the reached coordinate frames along the path, from the From coordinate frame towards the To coordinate frame
+  std::vector<int> pathFrames;
+  for (int frameIndex = static_cast<int>(toFrameIt - reachedFrames.begin()); frameIndex > 0; frameIndex = reachedFromFrame[frameIndex])
+  {
+    pathFrames.insert(pathFrames.begin(), frameIndex);
+  }
+  this->FrameInputs.clear();
+  this->Path.clear();
+  std::ostringstream pathDescription;
+  pathDescription << transformName.From();
+  for (std::vector<int>::iterator frameIt = pathFrames.begin(); frameIt != pathFrames.end(); ++frameIt)
+  {
+    const Edge& edge = edges[reachedThroughEdge[*frameIt]];
+    pathDescription << (edge.FrameInputIndex >= 0 ? " -> " : " => ") << reachedFrames[*frameIt];
+    PathStep step;
+    step.Inverse = (edge.To != reachedFrames[*frameIt]);
+    step.FrameInputIndex = -1;
+    if (edge.FrameInputIndex >= 0)
+    {
+      FrameInput input;
+      input.Name = frameTransformNames[edge.FrameInputIndex];
+      input.TransformName = input.Name.GetTransformName();
+      input.TransformFieldName = input.TransformName + "Transform";
+      input.StatusFieldName = input.TransformFieldName + "Status";
+      input.Valid = false;
+      input.StatusOk = true;
+      step.FrameInputIndex = static_cast<int>(this->FrameInputs.size());
+      this->FrameInputs.push_back(input);
+    }
+    else
+    {
+      vtkSmartPointer<vtkMatrix4x4> constantMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      ToolStatus status(TOOL_INVALID);
+      igsioTransformName constantTransformName(edge.From, edge.To);
+      if (transformRepository->GetTransform(constantTransformName, constantMatrix, &status) != IGSIO_SUCCESS || status != TOOL_OK)
+      {
+        LOG_ERROR("Constant transform " << constantTransformName.GetTransformName() << " is not available in the transform repository");
+        return PLUS_FAIL;
+      }
+      if (step.Inverse)
+      {
+        constantMatrix->Invert();
+      }
+      std::copy(&constantMatrix->Element[0][0], &constantMatrix->Element[0][0] + 16, step.ConstantMatrix);
+    }
+    this->Path.push_back(step);
+  }
+  LOG_INFO("Transform path (-> frame transform, => constant transform): " << pathDescription.str());
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void TransformPathEvaluator::ClearFrame()
+{
+  for (std::vector<FrameInput>::iterator inputIt = this->FrameInputs.begin(); inputIt != this->FrameInputs.end(); ++inputIt)
+  {
+    inputIt->Valid = false;
+    inputIt->StatusOk = true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TransformPathEvaluator::SetFrameField(const std::string& fieldName, const std::string& fieldValue)
+{
+  for (std::vector<FrameInput>::iterator inputIt = this->FrameInputs.begin(); inputIt != this->FrameInputs.end(); ++inputIt)
+  {
+    if (fieldName == inputIt->TransformFieldName)
+    {
+      const char* valuePos = fieldValue.c_str();
+      int numberOfElements = 0;
+      for (; numberOfElements < 16; ++numberOfElements)
+      {
+        char* valueEnd = NULL;
+        inputIt->Matrix[numberOfElements] = strtod(valuePos, &valueEnd);
+        if (valueEnd == valuePos)
+        {
+          break;
+        }
+        valuePos = valueEnd;
+      }
+      inputIt->Valid = (numberOfElements == 16);
+    }
+    else if (fieldName == inputIt->StatusFieldName)
+    {
+      inputIt->StatusOk = (fieldValue == "OK");
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TransformPathEvaluator::IsFrameFieldOnPath(const std::string& fieldName) const
+{
+  for (std::vector<FrameInput>::const_iterator inputIt = this->FrameInputs.begin(); inputIt != this->FrameInputs.end(); ++inputIt)
+  {
+    if (fieldName == inputIt->TransformFieldName || fieldName == inputIt->StatusFieldName)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void TransformPathEvaluator::SetFrameTransform(const std::string& transformName, const double matrix[16])
+{
+  for (std::vector<FrameInput>::iterator inputIt = this->FrameInputs.begin(); inputIt != this->FrameInputs.end(); ++inputIt)
+  {
+    if (transformName == inputIt->TransformName)
+    {
+      std::copy(matrix, matrix + 16, inputIt->Matrix);
+      inputIt->Valid = true;
+      inputIt->StatusOk = true;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TransformPathEvaluator::SetFrameFields(igsioTrackedFrame& trackedFrame)
+{
+  for (std::vector<FrameInput>::iterator inputIt = this->FrameInputs.begin(); inputIt != this->FrameInputs.end(); ++inputIt)
+  {
+    inputIt->Valid = (trackedFrame.GetFrameTransform(inputIt->Name, inputIt->Matrix) == IGSIO_SUCCESS);
+    ToolStatus status(TOOL_OK);
+    inputIt->StatusOk = (trackedFrame.GetFrameTransformStatus(inputIt->Name, status) != IGSIO_SUCCESS || status == TOOL_OK);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TransformPathEvaluator::Evaluate(double matrix[16]) const
+{
+  vtkMatrix4x4::Identity(matrix);
+  double stepMatrix[16];
+  double product[16];
+  for (std::vector<PathStep>::const_iterator stepIt = this->Path.begin(); stepIt != this->Path.end(); ++stepIt)
+  {
+    const double* stepElements = stepIt->ConstantMatrix;
+    if (stepIt->FrameInputIndex >= 0)
+    {
+      const FrameInput& input = this->FrameInputs[stepIt->FrameInputIndex];
+      if (!input.Valid || !input.StatusOk)
+      {
+        return false;
+      }
+      stepElements = input.Matrix;
+      if (stepIt->Inverse)
+      {
+        vtkMatrix4x4::Invert(input.Matrix, stepMatrix);
+        stepElements = stepMatrix;
+      }
+    }
+    // Steps are ordered from the From coordinate frame, so each step is applied after the previous ones
+    vtkMatrix4x4::Multiply4x4(stepElements, matrix, product);
+    std::copy(product, product + 16, matrix);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Appends the stylus tip position of the current frame to the points, if all transforms on the path are valid in the frame.
+void AddStylusTipPosition(const TransformPathEvaluator& stylusToReferenceEvaluator, vtkPoints* surfacePoints)
+{
+  double stylusToReferenceTransform[16];
+  if (!stylusToReferenceEvaluator.Evaluate(stylusToReferenceTransform))
+  {
+    // There is no available transform for this frame; skip that frame
+    return;
+  }
+  surfacePoints->InsertNextPoint(stylusToReferenceTransform[3], stylusToReferenceTransform[7], stylusToReferenceTransform[11]);
+}
+
+/*! Number of frames processed by a worker thread at a time in parallel extraction */
+static const int EXTRACTION_CHUNK_SIZE = 4096;
+
+//-----------------------------------------------------------------------------
+// Computes the stylus tip positions of frames [0, numberOfFrames) in chunks on a pool of worker threads,
+// then appends them to surfacePoints in frame order. Each chunk is processed with its own copy of the evaluator.
+// setFrameFields(evaluator, frameIndex) has to set the frame transforms of a frame in the evaluator.
+// std::thread is used instead of vtkSMPTools so that the frames are processed in parallel with the number of
+// threads given by --threads even if VTK was built with the sequential SMP backend.
+template<class SetFrameFieldsFunction>
+void ExtractStylusTipPositions(int numberOfFrames, const TransformPathEvaluator& stylusToReferenceEvaluator,
+                               SetFrameFieldsFunction setFrameFields, int numberOfThreads, vtkPoints* surfacePoints)
+{
+  const int numberOfChunks = (numberOfFrames + EXTRACTION_CHUNK_SIZE - 1) / EXTRACTION_CHUNK_SIZE;
+  std::vector< std::vector<double> > chunkPositions(numberOfChunks);
+  std::atomic<int> nextChunkIndex(0);
+  auto worker = [&]()
+  {
+    for (int chunkIndex = nextChunkIndex++; chunkIndex < numberOfChunks; chunkIndex = nextChunkIndex++)
+    {
+      TransformPathEvaluator evaluator(stylusToReferenceEvaluator);
+      std::vector<double>& positions = chunkPositions[chunkIndex];
+      positions.reserve(3 * EXTRACTION_CHUNK_SIZE);
+      const int endFrameIndex = std::min(numberOfFrames, (chunkIndex + 1) * EXTRACTION_CHUNK_SIZE);
+      for (int frameIndex = chunkIndex * EXTRACTION_CHUNK_SIZE; frameIndex < endFrameIndex; ++frameIndex)
+      {
+        setFrameFields(evaluator, frameIndex);
+        double stylusToReferenceTransform[16];
+        if (!evaluator.Evaluate(stylusToReferenceTransform))
+        {
+          // There is no available transform for this frame; skip that frame
+          continue;
+        }
+        positions.push_back(stylusToReferenceTransform[3]);
+        positions.push_back(stylusToReferenceTransform[7]);
+        positions.push_back(stylusToReferenceTransform[11]);
+      }
+    }
+  };
+
+  numberOfThreads = std::max(1, std::min(numberOfThreads, numberOfChunks));
+  std::vector<std::thread> threads;
+  for (int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    threads.push_back(std::thread(worker));
+  }
+  // The calling thread is one of the workers
+  worker();
+  for (std::vector<std::thread>::iterator threadIt = threads.begin(); threadIt != threads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+
+  // Merge the chunks in order
+  vtkIdType pointId = surfacePoints->GetNumberOfPoints();
+  vtkIdType numberOfPoints = pointId;
+  for (std::vector< std::vector<double> >::iterator chunkIt = chunkPositions.begin(); chunkIt != chunkPositions.end(); ++chunkIt)
+  {
+    numberOfPoints += static_cast<vtkIdType>(chunkIt->size() / 3);
+  }
+  surfacePoints->SetNumberOfPoints(numberOfPoints);
+  for (std::vector< std::vector<double> >::iterator chunkIt = chunkPositions.begin(); chunkIt != chunkPositions.end(); ++chunkIt)
+  {
+    for (size_t i = 0; i + 2 < chunkIt->size(); i += 3, ++pointId)
+    {
+      surfacePoints->SetPoint(pointId, (*chunkIt)[i], (*chunkIt)[i + 1], (*chunkIt)[i + 2]);
+    }
+  }
+}
+
+/*!
+  Frame transform fields on the path, read from a sequence file for a batch of frames.
+  Strings are reused between batches, so that memory is only allocated for the first batches.
+*/
+struct FrameFieldBatch
+{
+  FrameFieldBatch() : NumberOfFrames(0), NumberOfFields(0) {}
+  void Clear()
+  {
+    this->NumberOfFrames = 0;
+    this->NumberOfFields = 0;
+    this->FrameFieldBegin.assign(1, 0);
+  }
+  void AddField(const std::string& fieldName, const std::string& fieldValue)
+  {
+    if (this->NumberOfFields == this->FieldNames.size())
+    {
+      this->FieldNames.resize(this->NumberOfFields + 1);
+      this->FieldValues.resize(this->NumberOfFields + 1);
+    }
+    this->FieldNames[this->NumberOfFields] = fieldName;
+    this->FieldValues[this->NumberOfFields] = fieldValue;
+    this->NumberOfFields++;
+  }
+  void EndFrame()
+  {
+    this->NumberOfFrames++;
+    this->FrameFieldBegin.push_back(this->NumberOfFields);
+  }
+  void SetFrameFields(TransformPathEvaluator& evaluator, int frameIndex) const
+  {
+    evaluator.ClearFrame();
+    for (size_t fieldIndex = this->FrameFieldBegin[frameIndex]; fieldIndex < this->FrameFieldBegin[frameIndex + 1]; ++fieldIndex)
+    {
+      evaluator.SetFrameField(this->FieldNames[fieldIndex], this->FieldValues[fieldIndex]);
+    }
+  }
+
+  int NumberOfFrames;
+  size_t NumberOfFields;
+  /*! Fields of frame i are FieldNames[FrameFieldBegin[i]] ... FieldNames[FrameFieldBegin[i+1]-1] */
+  std::vector<size_t> FrameFieldBegin;
+  std::vector<std::string> FieldNames;
+  std::vector<std::string> FieldValues;
+};
+
+/*! Number of frames read from a sequence file before they are processed in parallel */
+static const int FRAME_FIELD_BATCH_SIZE = 64 * EXTRACTION_CHUNK_SIZE;
+
+//-----------------------------------------------------------------------------
+/*! Integer coordinates of a cell in a voxel grid */
+struct VoxelIndex
+{
+  long long I;
+  long long J;
+  long long K;
+  bool operator==(const VoxelIndex& other) const
+  {
+    return I == other.I && J == other.J && K == other.K;
+  }
+};
+
+struct VoxelIndexHash
+{
+  size_t operator()(const VoxelIndex& index) const
+  {
+    return static_cast<size_t>(index.I * 73856093LL ^ index.J * 19349663LL ^ index.K * 83492791LL);
+  }
+};
+
+//-----------------------------------------------------------------------------
+/*!
+  Accepts only the first point in each voxel of a grid with VoxelSize spacing, so that the number of points
+  is proportional to the digitized surface area instead of the recording length.
+  Points can be added one by one, so the same filter is used for offline and live extraction.
+*/
+class VoxelGridFilter
+{
+public:
+  explicit VoxelGridFilter(double voxelSize) : VoxelSize(voxelSize) {}
+
+  /*! Returns true if the point is the first one in its voxel */
+  bool AddPoint(const double point[3])
+  {
+    VoxelIndex voxel =
+    {
+      static_cast<long long>(std::floor(point[0] / this->VoxelSize)),
+      static_cast<long long>(std::floor(point[1] / this->VoxelSize)),
+      static_cast<long long>(std::floor(point[2] / this->VoxelSize))
+    };
+    return this->OccupiedVoxels.insert(voxel).second;
+  }
+
+protected:
+  double VoxelSize;
+  std::unordered_set<VoxelIndex, VoxelIndexHash> OccupiedVoxels;
+};
+
+//-----------------------------------------------------------------------------
+// Keeps only the first point in each voxel of a grid with voxelSize spacing. The order of points is preserved.
+vtkSmartPointer<vtkPoints> DecimatePoints(vtkPoints* points, double voxelSize)
+{
+  vtkSmartPointer<vtkPoints> decimatedPoints = vtkSmartPointer<vtkPoints>::New();
+  VoxelGridFilter voxelGridFilter(voxelSize);
+  double point[3] = {0, 0, 0};
+  for (vtkIdType pointId = 0; pointId < points->GetNumberOfPoints(); ++pointId)
+  {
+    points->GetPoint(pointId, point);
+    if (voxelGridFilter.AddPoint(point))
+    {
+      decimatedPoints->InsertNextPoint(point);
+    }
+  }
+  return decimatedPoints;
+}
+
+/*! Options of the generated output files */
+struct OutputOptions
+{
+  std::string PointsFileName;
+  std::string SurfaceFileName;
+  bool AddSpheres;
+  bool AddTube;
+  bool AddSurface;
+  double Radius;
+  int SurfaceNeighborhoodSize;
+  double SurfaceSampleSpacing;
+};
+
+//-----------------------------------------------------------------------------
+// Creates a polydata, with a vertex at each point
+vtkSmartPointer<vtkPolyData> CreatePointsPolyData(vtkPoints* surfacePoints)
+{
+  vtkSmartPointer<vtkCellArray> polyDataCells = vtkSmartPointer<vtkCellArray>::New();
+  for (vtkIdType ptIndex = 0; ptIndex < surfacePoints->GetNumberOfPoints(); ptIndex++)
+  {
+    polyDataCells->InsertNextCell(vtkIdType(1), &ptIndex);
+  }
+  vtkSmartPointer<vtkPolyData> pointsPolyData = vtkSmartPointer<vtkPolyData>::New();
+  pointsPolyData->SetPoints(surfacePoints);
+  pointsPolyData->SetVerts(polyDataCells);
+  return pointsPolyData;
+}
+
+//-----------------------------------------------------------------------------
+// Creates the points, spheres, tube, and reconstructed surface, as requested in the options
+vtkSmartPointer<vtkAppendPolyData> CreateOutputPolyData(vtkPolyData* pointsPolyData, const OutputOptions& options)
+{
+  vtkSmartPointer<vtkAppendPolyData> polyDataAppend = vtkSmartPointer<vtkAppendPolyData>::New();
+
+  polyDataAppend->AddInputData(pointsPolyData);
+
+  if (options.AddSpheres)
+  {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetThetaResolution(16);
+    sphere->SetPhiResolution(16);
+    sphere->SetRadius(options.Radius);
+    sphere->Update();
+    vtkSmartPointer<vtkGlyph3D> glyph = vtkSmartPointer<vtkGlyph3D>::New();
+    glyph->SetInputData(pointsPolyData);
+    glyph->SetSourceData(sphere->GetOutput());
+
+    polyDataAppend->AddInputConnection(glyph->GetOutputPort());
+  }
+
+  if (options.AddTube)
+  {
+    vtkSmartPointer<vtkLineSource> line = vtkSmartPointer<vtkLineSource>::New();
+    line->SetPoints(pointsPolyData->GetPoints());
+    vtkSmartPointer<vtkTubeFilter> tube = vtkSmartPointer<vtkTubeFilter>::New();
+    tube->SetInputConnection(line->GetOutputPort());
+    tube->SetNumberOfSides(32);
+    tube->SetRadius(options.Radius);
+    tube->CappingOn();
+    vtkSmartPointer<vtkTriangleFilter> triangulator = vtkSmartPointer<vtkTriangleFilter>::New();
+    triangulator->SetInputConnection(tube->GetOutputPort())    ;
+    polyDataAppend->AddInputConnection(triangulator->GetOutputPort());
+  }
+
+  if (options.AddSurface)
+  {
+    // Signed distance from the surface is computed on a grid, using normals estimated from the neighboring points
+    // (found using a point locator), then the zero level is extracted as a triangle mesh.
+    vtkSmartPointer<vtkSurfaceReconstructionFilter> surfaceReconstruction = vtkSmartPointer<vtkSurfaceReconstructionFilter>::New();
+    surfaceReconstruction->SetInputData(pointsPolyData);
+    surfaceReconstruction->SetNeighborhoodSize(options.SurfaceNeighborhoodSize);
+    surfaceReconstruction->SetSampleSpacing(options.SurfaceSampleSpacing > 0 ? options.SurfaceSampleSpacing : -1.0);
+    vtkSmartPointer<vtkContourFilter> contour = vtkSmartPointer<vtkContourFilter>::New();
+    contour->SetInputConnection(surfaceReconstruction->GetOutputPort());
+    contour->SetValue(0, 0.0);
+    // Contour triangles are oriented inwards, flip them
+    vtkSmartPointer<vtkReverseSense> reverseSense = vtkSmartPointer<vtkReverseSense>::New();
+    reverseSense->SetInputConnection(contour->GetOutputPort());
+    reverseSense->ReverseCellsOn();
+    reverseSense->ReverseNormalsOn();
+    polyDataAppend->AddInputConnection(reverseSense->GetOutputPort());
+  }
+
+  polyDataAppend->Update();
+  return polyDataAppend;
+}
+
+//-----------------------------------------------------------------------------
+void WriteOutputFiles(vtkPolyData* pointsPolyData, vtkAppendPolyData* polyDataAppend, const OutputOptions& options)
+{
+  if (!options.PointsFileName.empty())
+  {
+    LOG_INFO("Write points to " << options.PointsFileName);
+    vtkSmartPointer<vtkPLYWriter> polyWriter = vtkSmartPointer<vtkPLYWriter>::New();
+    polyWriter->SetInputData(pointsPolyData);
+    polyWriter->SetFileName(options.PointsFileName.c_str());
+    polyWriter->Update();
+  }
+  if (!options.SurfaceFileName.empty())
+  {
+    LOG_INFO("Write surface to " << options.SurfaceFileName);
+    vtkSmartPointer<vtkSTLWriter> polyWriter = vtkSmartPointer<vtkSTLWriter>::New();
+    polyWriter->SetInputData(polyDataAppend->GetOutput());
+    polyWriter->SetFileName(options.SurfaceFileName.c_str());
+    polyWriter->Update();
+  }
+}
+
+#ifdef PLUS_USE_OpenIGTLink
+/*! Update rate requested from the server in live mode */
+static const int LIVE_TRACKING_DATA_RESOLUTION_MSEC = 10;
+
+//-----------------------------------------------------------------------------
+// Returns the name of a transform received in a tracking data element or transform message.
+// PlusServer sends full transform names (e.g., StylusToTracker), other servers may only send the tool name,
+// then toFrameName (the device name of a TDATA message or the tracker reference frame) is used as the To coordinate frame.
+std::string GetReceivedTransformName(const std::string& name, const std::string& toFrameName)
+{
+  igsioTransformName transformName;
+  if (transformName.SetTransformName(name) == IGSIO_SUCCESS)
+  {
+    return name;
+  }
+  return name + "To" + toFrameName;
+}
+
+//-----------------------------------------------------------------------------
+// Receives TDATA and TRANSFORM messages from an OpenIGTLink server and appends the stylus tip positions to surfacePoints.
+// Snapshots of the output files are written periodically, so the digitized surface can be inspected during acquisition.
+// TRANSFORM messages that are named after the tool only are interpreted as ToolToTrackerReferenceFrame transforms.
+PlusStatus RunLiveExtraction(const std::string& hostname, int port, double durationSec, double snapshotIntervalSec,
+                             const igsioTransformName& stylusToReferenceTransformName, const std::string& trackerReferenceFrame, vtkXMLDataElement* configRootElement,
+                             vtkIGSIOTransformRepository* transformRepository, double voxelSize, const OutputOptions& options, vtkPoints* surfacePoints)
+{
+  igtl::ClientSocket::Pointer socket = igtl::ClientSocket::New();
+  if (socket->ConnectToServer(hostname.c_str(), port) != 0)
+  {
+    LOG_ERROR("Cannot connect to the server at " << hostname << ":" << port);
+    return PLUS_FAIL;
+  }
+  // Receive with timeout, so that snapshots are written and the acquisition time is checked even if no data arrives
+  socket->SetReceiveTimeout(static_cast<int>(std::max(100.0, std::min(1000.0, snapshotIntervalSec * 1000.0))));
+
+  igtl::StartTrackingDataMessage::Pointer startTracking = igtl::StartTrackingDataMessage::New();
+  startTracking->SetDeviceName("PointSetExtractor");
+  startTracking->SetResolution(LIVE_TRACKING_DATA_RESOLUTION_MSEC);
+  startTracking->Pack();
+  socket->Send(startTracking->GetBufferPointer(), startTracking->GetBufferSize());
+  LOG_INFO("Connected to " << hostname << ":" << port << ", receiving tracking data...");
+
+  TransformPathEvaluator stylusToReferenceEvaluator;
+  bool pathResolved = false;
+  std::vector<std::string> receivedTransformNames;
+  VoxelGridFilter voxelGridFilter(voxelSize);
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  igtl::TrackingDataMessage::Pointer trackingMsg = igtl::TrackingDataMessage::New();
+  igtl::TransformMessage::Pointer transformMsg = igtl::TransformMessage::New();
+  std::vector< std::pair<std::string, std::vector<double> > > messageTransforms;
+
+  const double startTimeSec = vtkTimerLog::GetUniversalTime();
+  double lastSnapshotTimeSec = startTimeSec;
+  vtkIdType numberOfPointsInLastSnapshot = 0;
+  while (durationSec <= 0 || vtkTimerLog::GetUniversalTime() - startTimeSec < durationSec)
+  {
+    const double nowSec = vtkTimerLog::GetUniversalTime();
+    if (snapshotIntervalSec > 0 && nowSec - lastSnapshotTimeSec >= snapshotIntervalSec && surfacePoints->GetNumberOfPoints() != numberOfPointsInLastSnapshot)
+    {
+      LOG_INFO("Snapshot: " << surfacePoints->GetNumberOfPoints() << " points");
+      vtkSmartPointer<vtkPolyData> pointsPolyData = CreatePointsPolyData(surfacePoints);
+      WriteOutputFiles(pointsPolyData, CreateOutputPolyData(pointsPolyData, options), options);
+      numberOfPointsInLastSnapshot = surfacePoints->GetNumberOfPoints();
+      lastSnapshotTimeSec = nowSec;
+    }
+
+    headerMsg->InitBuffer();
+    bool timeout(false);
+    igtlUint64 rs = socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize(), timeout);
+    if (timeout)
+    {
+      continue;
+    }
+    if (rs == 0)
+    {
+      LOG_INFO("Connection closed by the server");
+      break;
+    }
+    if (rs != headerMsg->GetBufferSize())
+    {
+      continue;
+    }
+    headerMsg->Unpack();
+
+    // Transforms in a TDATA message are a complete frame, a TRANSFORM message only updates one transform
+    messageTransforms.clear();
+    bool completeFrame = false;
+    if (strcmp(headerMsg->GetDeviceType(), "TDATA") == 0)
+    {
+      trackingMsg->SetMessageHeader(headerMsg);
+      trackingMsg->AllocateBuffer();
+      rs = socket->Receive(trackingMsg->GetBufferBodyPointer(), trackingMsg->GetBufferBodySize(), timeout);
+      if (rs != trackingMsg->GetBufferBodySize())
+      {
+        // The rest of the stream cannot be interpreted after a partially received message
+        LOG_ERROR("Incomplete message body received (" << rs << " of " << trackingMsg->GetBufferBodySize() << " bytes), closing the connection");
+        break;
+      }
+      if (!(trackingMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+      {
+        continue;
+      }
+      completeFrame = true;
+      for (int i = 0; i < trackingMsg->GetNumberOfTrackingDataElements(); ++i)
+      {
+        igtl::TrackingDataElement::Pointer trackingElement;
+        trackingMsg->GetTrackingDataElement(i, trackingElement);
+        igtl::Matrix4x4 matrix;
+        trackingElement->GetMatrix(matrix);
+        messageTransforms.push_back(std::make_pair(GetReceivedTransformName(trackingElement->GetName(), headerMsg->GetDeviceName()),
+                                    std::vector<double>(&matrix[0][0], &matrix[0][0] + 16)));
+      }
+    }
+    else if (strcmp(headerMsg->GetDeviceType(), "TRANSFORM") == 0)
+    {
+      transformMsg->SetMessageHeader(headerMsg);
+      transformMsg->AllocateBuffer();
+      rs = socket->Receive(transformMsg->GetBufferBodyPointer(), transformMsg->GetBufferBodySize(), timeout);
+      if (rs != transformMsg->GetBufferBodySize())
+      {
+        LOG_ERROR("Incomplete message body received (" << rs << " of " << transformMsg->GetBufferBodySize() << " bytes), closing the connection");
+        break;
+      }
+      if (!(transformMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+      {
+        continue;
+      }
+      igtl::Matrix4x4 matrix;
+      transformMsg->GetMatrix(matrix);
+      messageTransforms.push_back(std::make_pair(GetReceivedTransformName(headerMsg->GetDeviceName(), trackerReferenceFrame),
+                                  std::vector<double>(&matrix[0][0], &matrix[0][0] + 16)));
+    }
+    else
+    {
+      socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      continue;
+    }
+
+    // Resolve the transform path again whenever a new transform appears in the stream
+    bool newTransformReceived = false;
+    for (size_t i = 0; i < messageTransforms.size(); ++i)
+    {
+      if (std::find(receivedTransformNames.begin(), receivedTransformNames.end(), messageTransforms[i].first) == receivedTransformNames.end())
+      {
+        receivedTransformNames.push_back(messageTransforms[i].first);
+        newTransformReceived = true;
+      }
+    }
+    if (newTransformReceived)
+    {
+      std::vector<igsioTransformName> frameTransformNames;
+      for (std::vector<std::string>::iterator nameIt = receivedTransformNames.begin(); nameIt != receivedTransformNames.end(); ++nameIt)
+      {
+        igsioTransformName frameTransformName;
+        frameTransformName.SetTransformName(*nameIt);
+        frameTransformNames.push_back(frameTransformName);
+      }
+      // Not all transforms may have been received yet, so a missing path is not an error here
+      pathResolved = (stylusToReferenceEvaluator.Resolve(stylusToReferenceTransformName, frameTransformNames, configRootElement, transformRepository, true) == PLUS_SUCCESS);
+    }
+    if (!pathResolved)
+    {
+      continue;
+    }
+
+    if (completeFrame)
+    {
+      stylusToReferenceEvaluator.ClearFrame();
+    }
+    for (size_t i = 0; i < messageTransforms.size(); ++i)
+    {
+      stylusToReferenceEvaluator.SetFrameTransform(messageTransforms[i].first, &messageTransforms[i].second[0]);
+    }
+    double stylusToReferenceTransform[16];
+    if (!stylusToReferenceEvaluator.Evaluate(stylusToReferenceTransform))
+    {
+      continue;
+    }
+    const double stylusTipPosition[3] = { stylusToReferenceTransform[3], stylusToReferenceTransform[7], stylusToReferenceTransform[11] };
+    if (voxelSize <= 0 || voxelGridFilter.AddPoint(stylusTipPosition))
+    {
+      surfacePoints->InsertNextPoint(stylusTipPosition);
+    }
+  }
+
+  igtl::StopTrackingDataMessage::Pointer stopTracking = igtl::StopTrackingDataMessage::New();
+  stopTracking->SetDeviceName("PointSetExtractor");
+  stopTracking->Pack();
+  socket->Send(stopTracking->GetBufferPointer(), stopTracking->GetBufferSize());
+  socket->CloseSocket();
+
+  if (!pathResolved)
+  {
+    std::ostringstream receivedTransformNamesStr;
+    for (std::vector<std::string>::iterator nameIt = receivedTransformNames.begin(); nameIt != receivedTransformNames.end(); ++nameIt)
+    {
+      receivedTransformNamesStr << (nameIt != receivedTransformNames.begin() ? ", " : "") << *nameIt;
+    }
+    LOG_ERROR("No transform path found from " << stylusToReferenceTransformName.From() << " to " << stylusToReferenceTransformName.To()
+              << " using the received transforms (" << receivedTransformNamesStr.str() << ")");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Appends the stylus tip positions of all frames of a sequence file to surfacePoints
+PlusStatus ExtractPointsFromSequenceFile(const std::string& inputSequenceFileName, bool readImages, const igsioTransformName& stylusToReferenceTransformName,
+    vtkXMLDataElement* configRootElement, vtkIGSIOTransformRepository* transformRepository, int numberOfThreads, vtkPoints* surfacePoints)
+{
+  TransformPathEvaluator stylusToReferenceEvaluator;
+  if (!readImages && SequenceTransformReader::CanReadFile(inputSequenceFileName))
+  {
+    LOG_INFO("Read transforms from " << inputSequenceFileName << " and extract points...");
+    SequenceTransformReader reader;
+    if (reader.Open(inputSequenceFileName) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    // The transform path is resolved from the transform names of the first frame
+    igsioTrackedFrame firstFrame;
+    auto setFirstFrameField = [&firstFrame](const std::string & fieldName, const std::string & fieldValue)
+    {
+      if (igsioTrackedFrame::IsTransform(fieldName) || igsioTrackedFrame::IsTransformStatus(fieldName))
+      {
+        firstFrame.SetFrameField(fieldName, fieldValue);
+      }
+    };
+    if (reader.ReadNextFrame(setFirstFrameField) == PLUS_SUCCESS)
+    {
+      std::vector<igsioTransformName> frameTransformNames;
+      firstFrame.GetFrameTransformNameList(frameTransformNames);
+      if (stylusToReferenceEvaluator.Resolve(stylusToReferenceTransformName, frameTransformNames, configRootElement, transformRepository) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      stylusToReferenceEvaluator.SetFrameFields(firstFrame);
+      AddStylusTipPosition(stylusToReferenceEvaluator, surfacePoints);
+
+      // Reading the file is sequential, transforms are computed in parallel for batches of frames
+      FrameFieldBatch batch;
+      auto addFrameField = [&batch, &stylusToReferenceEvaluator](const std::string & fieldName, const std::string & fieldValue)
+      {
+        if (stylusToReferenceEvaluator.IsFrameFieldOnPath(fieldName))
+        {
+          batch.AddField(fieldName, fieldValue);
+        }
+      };
+      auto setBatchFrameFields = [&batch](TransformPathEvaluator & evaluator, int frameIndex)
+      {
+        batch.SetFrameFields(evaluator, frameIndex);
+      };
+      bool endOfFile = false;
+      while (!endOfFile)
+      {
+        batch.Clear();
+        while (batch.NumberOfFrames < FRAME_FIELD_BATCH_SIZE)
+        {
+          if (reader.ReadNextFrame(addFrameField) != PLUS_SUCCESS)
+          {
+            endOfFile = true;
+            break;
+          }
+          batch.EndFrame();
+        }
+        ExtractStylusTipPositions(batch.NumberOfFrames, stylusToReferenceEvaluator, setBatchFrameFields, numberOfThreads, surfacePoints);
+      }
+    }
+  }
+  else
+  {
+    LOG_INFO("Read " << inputSequenceFileName << "...");
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(inputSequenceFileName, trackedFrameList) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read tracked pose sequence metafile: " << inputSequenceFileName);
+      return PLUS_FAIL;
+    }
+
+    LOG_INFO("Extract points...");
+    if (trackedFrameList->GetNumberOfTrackedFrames() > 0)
+    {
+      std::vector<igsioTransformName> frameTransformNames;
+      trackedFrameList->GetTrackedFrame(0)->GetFrameTransformNameList(frameTransformNames);
+      if (stylusToReferenceEvaluator.Resolve(stylusToReferenceTransformName, frameTransformNames, configRootElement, transformRepository) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    auto setTrackedFrameFields = [&trackedFrameList](TransformPathEvaluator & evaluator, int frameIndex)
+    {
+      evaluator.SetFrameFields(*trackedFrameList->GetTrackedFrame(frameIndex));
+    };
+    ExtractStylusTipPositions(static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()), stylusToReferenceEvaluator,
+                              setTrackedFrameFields, numberOfThreads, surfacePoints);
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Processes many sequence files with the same configuration, one file per worker thread.
+// The configuration and transform repository are read once and only read by the workers.
+// Outputs of each input file are written to the output directory, named after the input file without its last extension.
+// If this name is the same for several input files (e.g., a.mha in two directories, or a.mha and a.nrrd), an index is appended.
+PlusStatus RunBatchExtraction(const std::vector<std::string>& inputFilePatterns, const std::string& outputDirectory, bool readImages,
+                              const igsioTransformName& stylusToReferenceTransformName, vtkXMLDataElement* configRootElement,
+                              vtkIGSIOTransformRepository* transformRepository, int numberOfThreads, double voxelSize, const OutputOptions& options)
+{
+  std::vector<std::string> inputFileNames;
+  for (std::vector<std::string>::const_iterator patternIt = inputFilePatterns.begin(); patternIt != inputFilePatterns.end(); ++patternIt)
+  {
+    if (patternIt->find_first_of("*?[") == std::string::npos)
+    {
+      inputFileNames.push_back(*patternIt);
+      continue;
+    }
+    vtksys::Glob glob;
+    glob.FindFiles(*patternIt);
+    std::vector<std::string> matchingFileNames = glob.GetFiles();
+    std::sort(matchingFileNames.begin(), matchingFileNames.end());
+    inputFileNames.insert(inputFileNames.end(), matchingFileNames.begin(), matchingFileNames.end());
+  }
+  if (inputFileNames.empty())
+  {
+    LOG_ERROR("No input sequence files found");
+    return PLUS_FAIL;
+  }
+  if (!vtksys::SystemTools::MakeDirectory(outputDirectory))
+  {
+    LOG_ERROR("Failed to create output directory " << outputDirectory);
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Process " << inputFileNames.size() << " sequence files...");
+
+  // Output names are assigned before processing, so that they do not depend on the order in which the files are finished.
+  // Names are compared case-insensitively, as the output directory may be on a case-insensitive file system.
+  std::vector<std::string> outputFileNamePrefixes;
+  auto isOutputFileNamePrefixUsed = [&outputFileNamePrefixes](const std::string & prefix)
+  {
+    for (std::vector<std::string>::const_iterator prefixIt = outputFileNamePrefixes.begin(); prefixIt != outputFileNamePrefixes.end(); ++prefixIt)
+    {
+      if (STRCASECMP(prefixIt->c_str(), prefix.c_str()) == 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (std::vector<std::string>::const_iterator inputIt = inputFileNames.begin(); inputIt != inputFileNames.end(); ++inputIt)
+  {
+    const std::string baseName = vtksys::SystemTools::GetFilenameWithoutLastExtension(*inputIt);
+    std::string outputFileNamePrefix = outputDirectory + "/" + baseName;
+    for (int index = 1; isOutputFileNamePrefixUsed(outputFileNamePrefix); ++index)
+    {
+      std::ostringstream indexedPrefix;
+      indexedPrefix << outputDirectory << "/" << baseName << "_" << index;
+      outputFileNamePrefix = indexedPrefix.str();
+    }
+    if (outputFileNamePrefix != outputDirectory + "/" + baseName)
+    {
+      LOG_WARNING("Output name " << baseName << " is already used by another input file, outputs of " << *inputIt << " are written to " << outputFileNamePrefix << ".*");
+    }
+    outputFileNamePrefixes.push_back(outputFileNamePrefix);
+  }
+
+  const bool writeSurface = options.AddSpheres || options.AddTube || options.AddSurface;
+  std::atomic<size_t> nextFileIndex(0);
+  std::atomic<int> numberOfFailedFiles(0);
+  auto worker = [&]()
+  {
+    for (size_t fileIndex = nextFileIndex++; fileIndex < inputFileNames.size(); fileIndex = nextFileIndex++)
+    {
+      const std::string& inputFileName = inputFileNames[fileIndex];
+      // Files are processed in parallel, so each file is processed by a single thread
+      vtkSmartPointer<vtkPoints> surfacePoints = vtkSmartPointer<vtkPoints>::New();
+      if (ExtractPointsFromSequenceFile(inputFileName, readImages, stylusToReferenceTransformName, configRootElement, transformRepository, 1, surfacePoints) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to extract points from " << inputFileName);
+        numberOfFailedFiles++;
+        continue;
+      }
+      if (voxelSize > 0)
+      {
+        surfacePoints = DecimatePoints(surfacePoints, voxelSize);
+      }
+      LOG_INFO(inputFileName << ": " << surfacePoints->GetNumberOfPoints() << " points");
+
+      OutputOptions fileOptions(options);
+      const std::string& outputFileNamePrefix = outputFileNamePrefixes[fileIndex];
+      fileOptions.PointsFileName = outputFileNamePrefix + ".ply";
+      fileOptions.SurfaceFileName = writeSurface ? outputFileNamePrefix + ".stl" : "";
+      vtkSmartPointer<vtkPolyData> pointsPolyData = CreatePointsPolyData(surfacePoints);
+      WriteOutputFiles(pointsPolyData, CreateOutputPolyData(pointsPolyData, fileOptions), fileOptions);
+    }
+  };
+
+  numberOfThreads = std::max(1, std::min(numberOfThreads, static_cast<int>(inputFileNames.size())));
+  std::vector<std::thread> threads;
+  for (int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    threads.push_back(std::thread(worker));
+  }
+  // The calling thread is one of the workers
+  worker();
+  for (std::vector<std::thread>::iterator threadIt = threads.begin(); threadIt != threads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+
+  if (numberOfFailedFiles > 0)
+  {
+    LOG_ERROR(numberOfFailedFiles << " of " << inputFileNames.size() << " sequence files could not be processed");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
 
@@ -61,6 +1265,21 @@ int main(int argc, char** argv)
   bool addTube = false;
   bool addSpheres = false;
   double radius = 1;
+  bool readImages = false;
+  int numberOfThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  double voxelSize = 0;
+  bool addSurface = false;
+  int surfaceNeighborhoodSize = 20;
+  double surfaceSampleSpacing = 0;
+  int livePort = -1;
+  std::vector<std::string> batchInputFilePatterns;
+  std::string batchOutputDirectory(".");
+#ifdef PLUS_USE_OpenIGTLink
+  std::string liveHostname("localhost");
+  double liveDurationSec = 0;
+  double snapshotIntervalSec = 5;
+  std::string trackerReferenceFrame("Tracker");
+#endif
 
   std::string stylusName("Stylus");
   std::string referenceName("Reference");
@@ -78,9 +1297,24 @@ int main(int argc, char** argv)
   args.AddArgument("--output-pointset-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputPointsFileName, "Filename of the output pointset file in PLY format (optional)");
   args.AddArgument("--display", vtksys::CommandLineArguments::NO_ARGUMENT, &display, "Show the points on the screen (optional)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
-  args.AddArgument("--output-surface-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputSurfaceFileName, "Filename of the output sruface file in STL format (required if spheres or tube added)");
+  args.AddArgument("--output-surface-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputSurfaceFileName, "Filename of the output sruface file in STL format (required if spheres, tube, or surface added)");
   args.AddArgument("--add-spheres", vtksys::CommandLineArguments::NO_ARGUMENT, &addSpheres, "Add a sphere at each point position (optional)");
   args.AddArgument("--add-tube", vtksys::CommandLineArguments::NO_ARGUMENT, &addTube, "Add a tube connecting the point positions (optional)");
+  args.AddArgument("--read-images", vtksys::CommandLineArguments::NO_ARGUMENT, &readImages, "Read the complete sequence file, including image data, into memory. By default only the transforms are read from MetaImage and NRRD files, frame by frame.");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads computing the point positions (Default: number of processor cores)");
+  args.AddArgument("--voxel-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &voxelSize, "Keep only one point in each cube of this size (in mm) to remove redundant points of dense recordings before generating the output. 0 means no decimation. (Default: 0)");
+  args.AddArgument("--add-surface", vtksys::CommandLineArguments::NO_ARGUMENT, &addSurface, "Add a surface reconstructed from the points (optional)");
+  args.AddArgument("--surface-neighborhood-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &surfaceNeighborhoodSize, "Number of neighboring points used for estimating the surface normal at each point (default: 20)");
+  args.AddArgument("--surface-sample-spacing", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &surfaceSampleSpacing, "Spacing of the grid used for surface reconstruction, in mm. 0 means it is computed from the point density. (default: 0)");
+  args.AddArgument("--batch-seq-files", vtksys::CommandLineArguments::MULTI_ARGUMENT, &batchInputFilePatterns, "Process all these sequence files with the same configuration. Wildcards (*, ?) are allowed. Files are processed in parallel (see --threads) and the outputs of each file are written to --batch-output-dir.");
+  args.AddArgument("--batch-output-dir", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &batchOutputDirectory, "Output directory in batch mode. The points (.ply) and surface (.stl, if spheres, tube, or surface added) are named after the input file without its last extension, with an index appended if the name is not unique. (Default: current directory)");
+#ifdef PLUS_USE_OpenIGTLink
+  args.AddArgument("--live-host", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &liveHostname, "Host name of the OpenIGTLink server in live mode (Default: localhost)");
+  args.AddArgument("--live-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &livePort, "Extract points live from the tracking data (TDATA or TRANSFORM messages) of an OpenIGTLink server listening on this port, instead of reading a sequence file");
+  args.AddArgument("--live-duration", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &liveDurationSec, "Length of live acquisition in seconds. 0 means until the server closes the connection. (Default: 0)");
+  args.AddArgument("--snapshot-interval", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &snapshotIntervalSec, "Time between writing the output files in live mode, in seconds (Default: 5)");
+  args.AddArgument("--tracker-reference-frame", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &trackerReferenceFrame, "Name of the tracker's reference frame, used as the To coordinate frame of TRANSFORM messages that are named after the tool only (Default: Tracker)");
+#endif
   args.AddArgument("--radius", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &radius, "Radius of the tube or speheres (default: 5)");
 
   if (!args.Parse())
@@ -96,30 +1330,25 @@ int main(int argc, char** argv)
     exit(EXIT_SUCCESS);
 
   }
-  if (inputSequenceFileName.empty())
+  if (inputSequenceFileName.empty() && livePort <= 0 && batchInputFilePatterns.empty())
   {
-    std::cerr << "input-seq-file-name is required" << std::endl;
+    std::cerr << "One of --source-seq-file, --live-port or --batch-seq-files is required" << std::endl;
     exit(EXIT_FAILURE);
   }
-
-  // Read the file and do the conversion
-  ///////////////
-
-  LOG_INFO("Read input file...");
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (vtkPlusSequenceIO::Read(inputSequenceFileName, trackedFrameList) != PLUS_SUCCESS)
+  if (!batchInputFilePatterns.empty() && (!outputPointsFileName.empty() || !outputSurfaceFileName.empty() || display))
   {
-    LOG_ERROR("Failed to read tracked pose sequence metafile: " << inputSequenceFileName);
-    return EXIT_FAILURE;
+    std::cerr << "--output-pointset-file, --output-surface-file and --display cannot be used with --batch-seq-files, the outputs are written to --batch-output-dir" << std::endl;
+    exit(EXIT_FAILURE);
   }
 
   vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
 
   // Read config file
+  vtkSmartPointer<vtkXMLDataElement> configRead;
   if (!inputConfigFileName.empty())
   {
     LOG_DEBUG("Reading config file...")
-    vtkSmartPointer<vtkXMLDataElement> configRead = vtkSmartPointer<vtkXMLDataElement>::Take(::vtkXMLUtilities::ReadElementFromFile(inputConfigFileName.c_str()));
+    configRead = vtkSmartPointer<vtkXMLDataElement>::Take(::vtkXMLUtilities::ReadElementFromFile(inputConfigFileName.c_str()));
     transformRepository->ReadConfiguration(configRead);
     LOG_DEBUG("Reading config file finished.");
   }
@@ -131,96 +1360,57 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
-  //  Get StylusTip positions in the reference coordinate frame
-  LOG_INFO("Extract points...");
-  vtkSmartPointer<vtkPoints> surfacePoints = vtkSmartPointer<vtkPoints>::New();
-  double stylusTipPositionInReferenceFrame[4] = {0, 0, 0, 1};
-  for (unsigned int frame = 0; frame < trackedFrameList->GetNumberOfTrackedFrames(); ++frame)
-  {
-    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(frame);
-    transformRepository->SetTransforms(*trackedFrame);
-    vtkSmartPointer<vtkMatrix4x4> stylusToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    ToolStatus status(TOOL_INVALID);
-    transformRepository->GetTransform(stylusToReferenceTransformName, stylusToReferenceTransform, &status);
-    if (status != TOOL_OK)
-    {
-      // There is no available transform for this frame; skip that frame
-      continue;
-    }
-    stylusTipPositionInReferenceFrame[0] = stylusToReferenceTransform->Element[0][3];
-    stylusTipPositionInReferenceFrame[1] = stylusToReferenceTransform->Element[1][3];
-    stylusTipPositionInReferenceFrame[2] = stylusToReferenceTransform->Element[2][3];
+  // Read the file and get StylusTip positions in the reference coordinate frame
+  ///////////////
 
-    LOG_DEBUG("Stylus tip position: "
-              << stylusTipPositionInReferenceFrame[0] << ",   "
-              << stylusTipPositionInReferenceFrame[1] << ",   "
-              << stylusTipPositionInReferenceFrame[2]);
-    surfacePoints->InsertNextPoint(stylusTipPositionInReferenceFrame);
-  }
-  int numberOfPoints = surfacePoints->GetNumberOfPoints();
-  LOG_INFO("Number of points: " << numberOfPoints);
+  OutputOptions outputOptions;
+  outputOptions.PointsFileName = outputPointsFileName;
+  outputOptions.SurfaceFileName = outputSurfaceFileName;
+  outputOptions.AddSpheres = addSpheres;
+  outputOptions.AddTube = addTube;
+  outputOptions.AddSurface = addSurface;
+  outputOptions.Radius = radius;
+  outputOptions.SurfaceNeighborhoodSize = surfaceNeighborhoodSize;
+  outputOptions.SurfaceSampleSpacing = surfaceSampleSpacing;
 
-  // Create a polydata, with a vertex at each point
-  vtkSmartPointer<vtkCellArray> polyDataCells = vtkSmartPointer<vtkCellArray>::New();
-  for (vtkIdType ptIndex = 0; ptIndex < numberOfPoints; ptIndex++)
+  if (!batchInputFilePatterns.empty())
   {
-    polyDataCells->InsertNextCell(vtkIdType(1), &ptIndex);
+    return (RunBatchExtraction(batchInputFilePatterns, batchOutputDirectory, readImages, stylusToReferenceTransformName, configRead,
+                               transformRepository, numberOfThreads, voxelSize, outputOptions) == PLUS_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
   }
-  vtkSmartPointer<vtkPolyData> pointsPolyData = vtkSmartPointer<vtkPolyData>::New();
-  pointsPolyData->SetPoints(surfacePoints);
-  pointsPolyData->SetVerts(polyDataCells);
 
-  vtkSmartPointer<vtkAppendPolyData> polyDataAppend = vtkSmartPointer<vtkAppendPolyData>::New();
-
-  polyDataAppend->AddInputData(pointsPolyData);
-
-  if (addSpheres)
+  vtkSmartPointer<vtkPoints> surfacePoints = vtkSmartPointer<vtkPoints>::New();
+  if (livePort > 0)
   {
-    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
-    sphere->SetThetaResolution(16);
-    sphere->SetPhiResolution(16);
-    sphere->SetRadius(radius);
-    sphere->Update();
-    vtkSmartPointer<vtkGlyph3D> glyph = vtkSmartPointer<vtkGlyph3D>::New();
-    glyph->SetInputData(pointsPolyData);
-    glyph->SetSourceData(sphere->GetOutput());
-
-    polyDataAppend->AddInputConnection(glyph->GetOutputPort());
+#ifdef PLUS_USE_OpenIGTLink
+    // Points are decimated as they arrive
+    if (RunLiveExtraction(liveHostname, livePort, liveDurationSec, snapshotIntervalSec, stylusToReferenceTransformName, trackerReferenceFrame, configRead,
+                          transformRepository, voxelSize, outputOptions, surfacePoints) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+    voxelSize = 0;
+#endif
   }
-
-  if (addTube)
+  else if (ExtractPointsFromSequenceFile(inputSequenceFileName, readImages, stylusToReferenceTransformName, configRead,
+                                        transformRepository, numberOfThreads, surfacePoints) != PLUS_SUCCESS)
   {
-    vtkSmartPointer<vtkLineSource> line = vtkSmartPointer<vtkLineSource>::New();
-    line->SetPoints(surfacePoints);
-    vtkSmartPointer<vtkTubeFilter> tube = vtkSmartPointer<vtkTubeFilter>::New();
-    tube->SetInputConnection(line->GetOutputPort());
-    tube->SetNumberOfSides(32);
-    tube->SetRadius(radius);
-    tube->CappingOn();
-    vtkSmartPointer<vtkTriangleFilter> triangulator = vtkSmartPointer<vtkTriangleFilter>::New();
-    triangulator->SetInputConnection(tube->GetOutputPort())    ;
-    polyDataAppend->AddInputConnection(triangulator->GetOutputPort());
+    return EXIT_FAILURE;
+  }
+  if (voxelSize > 0)
+  {
+    vtkIdType numberOfExtractedPoints = surfacePoints->GetNumberOfPoints();
+    surfacePoints = DecimatePoints(surfacePoints, voxelSize);
+    LOG_INFO("Decimated " << numberOfExtractedPoints << " points with " << voxelSize << "mm voxel size");
   }
+  int numberOfPoints = surfacePoints->GetNumberOfPoints();
+  LOG_INFO("Number of points: " << numberOfPoints);
 
-  polyDataAppend->Update();
+  vtkSmartPointer<vtkPolyData> pointsPolyData = CreatePointsPolyData(surfacePoints);
+  vtkSmartPointer<vtkAppendPolyData> polyDataAppend = CreateOutputPolyData(pointsPolyData, outputOptions);
 
   // Write to output file
-  if (!outputPointsFileName.empty())
-  {
-    LOG_INFO("Write points to " << outputPointsFileName);
-    vtkSmartPointer<vtkPLYWriter> polyWriter = vtkSmartPointer<vtkPLYWriter>::New();
-    polyWriter->SetInputData(pointsPolyData);
-    polyWriter->SetFileName(outputPointsFileName.c_str());
-    polyWriter->Update();
-  }
-  if (!outputSurfaceFileName.empty())
-  {
-    LOG_INFO("Write surface to " << outputSurfaceFileName);
-    vtkSmartPointer<vtkSTLWriter> polyWriter = vtkSmartPointer<vtkSTLWriter>::New();
-    polyWriter->SetInputData(polyDataAppend->GetOutput());
-    polyWriter->SetFileName(outputSurfaceFileName.c_str());
-    polyWriter->Update();
-  }
+  WriteOutputFiles(pointsPolyData, polyDataAppend, outputOptions);
 
   // Display points in 3D renderer
   if (display)
@@ -23,10 +23,22 @@ See License.txt for details.
 #include "vtkPlusSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
+#include "vtkTimerLog.h"
 #include "vtkTransform.h"
 #include "vtksys/CommandLineArguments.hxx"
+#ifdef PLUS_USE_OpenIGTLink
+#include "igtlClientSocket.h"
+#include "igtlMessageHeader.h"
+#include "igtlTrackingDataMessage.h"
+#include "igtlTransformMessage.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 
 // Define tolerance used for comparing double numbers.
 // There are relatively large differences between results computed by different compiler versions.
@@ -38,6 +50,54 @@ See License.txt for details.
 
 void Update(AhrsAlgo* ahrsAlgo, igsioTrackedFrame* frame, const std::string& trackerReferenceFrame, int westAxisIndex, bool useTimestamps, vtkMatrix4x4* filteredTiltSensorToTrackerTransformReturn = NULL);
 
+/*! Gyroscope and accelerometer samples of all frames, stored in contiguous arrays */
+struct ImuSamples
+{
+  int GetNumberOfSamples() const { return static_cast<int>(Timestamps.size()); }
+
+  std::vector<double> Timestamps;
+  /*! Angular velocity in rad/s */
+  std::vector<double> GyroscopeX;
+  std::vector<double> GyroscopeY;
+  std::vector<double> GyroscopeZ;
+  std::vector<double> AccelerometerX;
+  std::vector<double> AccelerometerY;
+  std::vector<double> AccelerometerZ;
+};
+
+/*! Gains and initialization parameters of the AHRS algorithm */
+struct AhrsParameters
+{
+  float ProportionalGain;
+  float IntegralGain;
+  float InitialProportionalGain;
+  float InitialIntegralGain;
+  int NumberOfRepeatedFramesForInitialization;
+  int WestAxisIndex;
+};
+
+AhrsAlgo* CreateAhrsAlgo(const std::string& ahrsAlgoName);
+void ExtractImuSamples(vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, ImuSamples& samples);
+void ProcessImuSamples(AhrsAlgo* ahrsAlgo, const ImuSamples& samples, const AhrsParameters& parameters, std::vector<double>& filteredTiltSensorToTrackerMatrices);
+void SetFilteredTiltSensorTransforms(vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, const std::vector<double>& filteredTiltSensorToTrackerMatrices);
+void ProcessFrames(AhrsAlgo* ahrsAlgo, vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, const AhrsParameters& parameters, std::vector<double>& filteredTiltSensorToTrackerMatrices);
+
+/*! One algorithm and parameter combination of the gain sweep, with its orientation error compared to the reference */
+struct SweepConfiguration
+{
+  std::string AhrsAlgoName;
+  AhrsParameters Parameters;
+  double MeanErrorDeg;
+  double MaxErrorDeg;
+  int NumberOfComparedFrames;
+};
+
+PlusStatus RunGainSweep(vtkIGSIOTrackedFrameList* frameList, vtkIGSIOTrackedFrameList* referenceFrameList, const igsioTransformName& referenceTransformName,
+                        const std::string& trackerReferenceFrame, std::vector<SweepConfiguration>& configurations, int numberOfThreads, const std::string& outputFileName);
+#ifdef PLUS_USE_OpenIGTLink
+PlusStatus RunLiveFusion(const std::string& hostname, int port, double durationSec, AhrsAlgo* ahrsAlgo, const AhrsParameters& parameters, const std::string& trackerReferenceFrame);
+#endif
+
 //-----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -52,6 +112,21 @@ int main(int argc, char** argv)
   int westAxisIndex = 0;
   int numberOfRepeatedFramesForInitialization = 0;
   std::vector<double> initialAhrsAlgoGain;
+  bool benchmark(false);
+  bool sweep(false);
+  std::vector<std::string> sweepAhrsAlgoNames;
+  std::vector<double> sweepProportionalGains;
+  std::vector<double> sweepIntegralGains;
+  std::vector<double> sweepInitialProportionalGains;
+  std::vector<int> sweepNumbersOfRepeatedFramesForInitialization;
+  std::string sweepReferenceTransformNameStr;
+  std::string sweepOutputFile;
+  int numberOfThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  int livePort = -1;
+#ifdef PLUS_USE_OpenIGTLink
+  std::string liveHostname("localhost");
+  double liveDurationSec = 0;
+#endif
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -67,6 +142,21 @@ int main(int argc, char** argv)
   args.AddArgument("--initial-repeated-frame-number", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepeatedFramesForInitialization, "Number of frames to process at initial high gain for convergance");
   args.AddArgument("--initial-gain", vtksys::CommandLineArguments::MULTI_ARGUMENT, &initialAhrsAlgoGain, "Gain to use during initial frames for faster convergance");
   args.AddArgument("--baseline-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &baselineImgFile, "Known good baseline file used to validate results for testing");
+  args.AddArgument("--benchmark", vtksys::CommandLineArguments::NO_ARGUMENT, &benchmark, "Compare processing time and results of the batch and the frame-by-frame processing");
+  args.AddArgument("--sweep", vtksys::CommandLineArguments::NO_ARGUMENT, &sweep, "Evaluate all combinations of the --sweep-* parameter lists and report the orientation error of each compared to the reference. No output sequence file is written.");
+  args.AddArgument("--sweep-ahrs-algos", vtksys::CommandLineArguments::MULTI_ARGUMENT, &sweepAhrsAlgoNames, "AHRS algorithms to evaluate in sweep mode (Default: --ahrs-algo)");
+  args.AddArgument("--sweep-ahrs-algo-gains", vtksys::CommandLineArguments::MULTI_ARGUMENT, &sweepProportionalGains, "Proportional feedback gains to evaluate in sweep mode (Default: first value of --ahrs-algo-gain)");
+  args.AddArgument("--sweep-integral-gains", vtksys::CommandLineArguments::MULTI_ARGUMENT, &sweepIntegralGains, "Integral feedback gains to evaluate in sweep mode (Default: second value of --ahrs-algo-gain)");
+  args.AddArgument("--sweep-initial-gains", vtksys::CommandLineArguments::MULTI_ARGUMENT, &sweepInitialProportionalGains, "Initial proportional feedback gains to evaluate in sweep mode (Default: first value of --initial-gain)");
+  args.AddArgument("--sweep-initial-repeated-frame-numbers", vtksys::CommandLineArguments::MULTI_ARGUMENT, &sweepNumbersOfRepeatedFramesForInitialization, "Numbers of initial frames to evaluate in sweep mode (Default: --initial-repeated-frame-number)");
+  args.AddArgument("--sweep-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &sweepReferenceTransformNameStr, "Transform of the input sequence file used as reference orientation in sweep mode, for example TiltSensorToTracker (Default: FilteredTiltSensorToTracker transform of --baseline-seq-file)");
+  args.AddArgument("--sweep-output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &sweepOutputFile, "Name of the CSV file the sweep results are written to");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads evaluating configurations in sweep mode (Default: number of processor cores)");
+#ifdef PLUS_USE_OpenIGTLink
+  args.AddArgument("--live-host", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &liveHostname, "Host name of the OpenIGTLink server in live mode (Default: localhost)");
+  args.AddArgument("--live-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &livePort, "Process the Gyroscope and Accelerometer transforms (TDATA or TRANSFORM messages) of an OpenIGTLink server listening on this port, instead of reading a sequence file. The FilteredTiltSensor transform is sent back to the server as TRANSFORM message.");
+  args.AddArgument("--live-duration", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &liveDurationSec, "Length of live processing in seconds. 0 means until the server closes the connection. (Default: 0)");
+#endif
 
   // Input arguments error checking
   if (!args.Parse())
@@ -84,94 +174,213 @@ int main(int argc, char** argv)
 
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
 
-  if (inputImgFile.empty())
+  if (inputImgFile.empty() && livePort <= 0)
   {
     std::cerr << "--input-seq-file required" << std::endl;
     exit(EXIT_FAILURE);
   }
-  if (outputImgFile.empty())
+  if (outputImgFile.empty() && !sweep && livePort <= 0)
   {
     std::cerr << "Missing --output-seq-file parameter. Specification of the output image file name is required." << std::endl;
     exit(EXIT_FAILURE);
   }
 
-  // Read transformations data
-  LOG_DEBUG("Reading input meta file...");
-  vtkSmartPointer< vtkIGSIOTrackedFrameList > frameList = vtkSmartPointer< vtkIGSIOTrackedFrameList >::New();
-  if (vtkPlusSequenceIO::Read(inputImgFile, frameList) != PLUS_SUCCESS)
+  AhrsParameters parameters;
+  parameters.ProportionalGain = 1.5;
+  parameters.IntegralGain = 0.0;
+  if (ahrsAlgoGain.size() > 0)
   {
-    LOG_ERROR("Unable to load input sequences file.");
-    return EXIT_FAILURE;
+    parameters.ProportionalGain = ahrsAlgoGain[0];
   }
-  LOG_DEBUG("Reading input file completed");
-
-
-  //set up Ahrs Algorithm
-  AhrsAlgo* ahrsAlgo = NULL;
-  if (STRCASECMP("MADGWICK_IMU", ahrsAlgoName.c_str()) == 0)
+  if (ahrsAlgoGain.size() > 1)
   {
-    ahrsAlgo = new MadgwickAhrsAlgo;
+    parameters.IntegralGain = ahrsAlgoGain[1];
   }
-  else if (STRCASECMP("MAHONY_IMU", ahrsAlgoName.c_str()) == 0)
+
+  parameters.InitialProportionalGain = 1.5;
+  parameters.InitialIntegralGain = 0.0;
+  if (initialAhrsAlgoGain.size() > 0)
   {
-    ahrsAlgo = new MahonyAhrsAlgo;
+    parameters.InitialProportionalGain = initialAhrsAlgoGain[0];
   }
-  else
+  if (initialAhrsAlgoGain.size() > 1)
   {
-    LOG_ERROR("Unable to recognize AHRS algorithm type: " << ahrsAlgoName << ". Supported types: MADGWICK_IMU, MAHONY_IMU");
-    exit(EXIT_FAILURE);
+    parameters.InitialIntegralGain = initialAhrsAlgoGain[1];
   }
+  parameters.NumberOfRepeatedFramesForInitialization = numberOfRepeatedFramesForInitialization;
+  parameters.WestAxisIndex = westAxisIndex;
 
-  float proportionalGain = 1.5;
-  float integralGain = 0.0;
-  if (ahrsAlgoGain.size() > 0)
+  if (livePort > 0)
   {
-    proportionalGain = ahrsAlgoGain[0];
+#ifdef PLUS_USE_OpenIGTLink
+    AhrsAlgo* ahrsAlgo = CreateAhrsAlgo(ahrsAlgoName);
+    if (ahrsAlgo == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+    PlusStatus status = RunLiveFusion(liveHostname, livePort, liveDurationSec, ahrsAlgo, parameters, trackerReferenceFrame);
+    delete ahrsAlgo;
+    return (status == PLUS_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
   }
-  if (ahrsAlgoGain.size() > 1)
+
+  // Read transformations data
+  LOG_DEBUG("Reading input meta file...");
+  vtkSmartPointer< vtkIGSIOTrackedFrameList > frameList = vtkSmartPointer< vtkIGSIOTrackedFrameList >::New();
+  if (vtkPlusSequenceIO::Read(inputImgFile, frameList) != PLUS_SUCCESS)
   {
-    integralGain = ahrsAlgoGain[1];
+    LOG_ERROR("Unable to load input sequences file.");
+    return EXIT_FAILURE;
   }
+  LOG_DEBUG("Reading input file completed");
 
-  float initialProportionalGain = 1.5;
-  float initialIntegralGain = 0.0;
-  if (initialAhrsAlgoGain.size() > 0)
+  int nFrames = frameList->GetNumberOfTrackedFrames();
+  if (nFrames < 2)
   {
-    initialProportionalGain = initialAhrsAlgoGain[0];
+    LOG_ERROR("At least 2 frames are required in the input sequence file");
+    return EXIT_FAILURE;
   }
-  if (initialAhrsAlgoGain.size() > 1)
+
+  if (sweep)
   {
-    initialIntegralGain = initialAhrsAlgoGain[1];
-  }
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> referenceFrameList = frameList;
+    igsioTransformName referenceTransformName;
+    if (!sweepReferenceTransformNameStr.empty())
+    {
+      if (referenceTransformName.SetTransformName(sweepReferenceTransformNameStr) != IGSIO_SUCCESS)
+      {
+        LOG_ERROR("Invalid reference transform name: " << sweepReferenceTransformNameStr);
+        return EXIT_FAILURE;
+      }
+    }
+    else if (!baselineImgFile.empty())
+    {
+      referenceFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (vtkPlusSequenceIO::Read(baselineImgFile, referenceFrameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to load baseline sequence file.");
+        return EXIT_FAILURE;
+      }
+      referenceTransformName = igsioTransformName("FilteredTiltSensor", trackerReferenceFrame);
+    }
+    else
+    {
+      LOG_ERROR("Sweep mode requires --baseline-seq-file or --sweep-reference-transform");
+      return EXIT_FAILURE;
+    }
 
-  // Process the frames
+    if (sweepAhrsAlgoNames.empty())
+    {
+      sweepAhrsAlgoNames.push_back(ahrsAlgoName);
+    }
+    if (sweepProportionalGains.empty())
+    {
+      sweepProportionalGains.push_back(parameters.ProportionalGain);
+    }
+    if (sweepIntegralGains.empty())
+    {
+      sweepIntegralGains.push_back(parameters.IntegralGain);
+    }
+    if (sweepInitialProportionalGains.empty())
+    {
+      sweepInitialProportionalGains.push_back(parameters.InitialProportionalGain);
+    }
+    if (sweepNumbersOfRepeatedFramesForInitialization.empty())
+    {
+      sweepNumbersOfRepeatedFramesForInitialization.push_back(parameters.NumberOfRepeatedFramesForInitialization);
+    }
 
-  // Initialization with the same frame
-  ahrsAlgo->SetGain(initialProportionalGain, initialIntegralGain);
-  igsioTrackedFrame* frame0 = frameList->GetTrackedFrame(0);
-  igsioTrackedFrame* frame1 = frameList->GetTrackedFrame(1);
-  double samplingFreqHz = 125;
-  double timeDiffSec = fabs(frame1->GetTimestamp() - frame0->GetTimestamp());
-  if (timeDiffSec > 1e-4)
-  {
-    samplingFreqHz = 1 / timeDiffSec;
+    std::vector<SweepConfiguration> configurations;
+    for (std::vector<std::string>::iterator algoIt = sweepAhrsAlgoNames.begin(); algoIt != sweepAhrsAlgoNames.end(); ++algoIt)
+    {
+      // Validate the algorithm name once, before any processing is started
+      AhrsAlgo* ahrsAlgo = CreateAhrsAlgo(*algoIt);
+      if (ahrsAlgo == NULL)
+      {
+        return EXIT_FAILURE;
+      }
+      delete ahrsAlgo;
+      for (std::vector<double>::iterator gainIt = sweepProportionalGains.begin(); gainIt != sweepProportionalGains.end(); ++gainIt)
+      {
+        for (std::vector<double>::iterator integralGainIt = sweepIntegralGains.begin(); integralGainIt != sweepIntegralGains.end(); ++integralGainIt)
+        {
+          for (std::vector<double>::iterator initialGainIt = sweepInitialProportionalGains.begin(); initialGainIt != sweepInitialProportionalGains.end(); ++initialGainIt)
+          {
+            for (std::vector<int>::iterator initialFramesIt = sweepNumbersOfRepeatedFramesForInitialization.begin(); initialFramesIt != sweepNumbersOfRepeatedFramesForInitialization.end(); ++initialFramesIt)
+            {
+              SweepConfiguration configuration;
+              configuration.AhrsAlgoName = *algoIt;
+              configuration.Parameters = parameters;
+              configuration.Parameters.ProportionalGain = *gainIt;
+              configuration.Parameters.IntegralGain = *integralGainIt;
+              configuration.Parameters.InitialProportionalGain = *initialGainIt;
+              configuration.Parameters.NumberOfRepeatedFramesForInitialization = *initialFramesIt;
+              configuration.MeanErrorDeg = 0;
+              configuration.MaxErrorDeg = 0;
+              configuration.NumberOfComparedFrames = 0;
+              configurations.push_back(configuration);
+            }
+          }
+        }
+      }
+    }
+
+    return (RunGainSweep(frameList, referenceFrameList, referenceTransformName, trackerReferenceFrame, configurations, numberOfThreads, sweepOutputFile) == PLUS_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
   }
-  ahrsAlgo->SetSampleFreqHz(samplingFreqHz);
-  for (int frameIndex = 0; frameIndex < numberOfRepeatedFramesForInitialization; frameIndex++)
+
+  //set up Ahrs Algorithm
+  AhrsAlgo* ahrsAlgo = CreateAhrsAlgo(ahrsAlgoName);
+  if (ahrsAlgo == NULL)
   {
-    Update(ahrsAlgo, frame0, trackerReferenceFrame, westAxisIndex, false);
+    exit(EXIT_FAILURE);
   }
 
-  //set gain to normal running value after convergence time
-  ahrsAlgo->SetGain(proportionalGain, integralGain);
-  int nFrames = frameList->GetNumberOfTrackedFrames();
-  vtkSmartPointer<vtkMatrix4x4> filteredTiltSensorToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-  for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+  // Process the frames: sensor data is extracted once into contiguous arrays, the AHRS algorithm runs
+  // on the arrays without allocating memory per sample, then the results are written back to the frames
+  double startTimeSec = vtkTimerLog::GetUniversalTime();
+  ImuSamples samples;
+  ExtractImuSamples(frameList, trackerReferenceFrame, samples);
+  double extractedTimeSec = vtkTimerLog::GetUniversalTime();
+  std::vector<double> filteredTiltSensorToTrackerMatrices;
+  ProcessImuSamples(ahrsAlgo, samples, parameters, filteredTiltSensorToTrackerMatrices);
+  double processedTimeSec = vtkTimerLog::GetUniversalTime();
+  SetFilteredTiltSensorTransforms(frameList, trackerReferenceFrame, filteredTiltSensorToTrackerMatrices);
+  double writtenTimeSec = vtkTimerLog::GetUniversalTime();
+  delete ahrsAlgo;
+  ahrsAlgo = NULL;
+
+  if (benchmark)
   {
-    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
-    Update(ahrsAlgo, frame, trackerReferenceFrame, westAxisIndex, true, filteredTiltSensorToTrackerTransform);
-    frame->SetFrameTransform(igsioTransformName("FilteredTiltSensor", trackerReferenceFrame), filteredTiltSensorToTrackerTransform);
-    frame->SetFrameTransformStatus(igsioTransformName("FilteredTiltSensor", trackerReferenceFrame), TOOL_OK);
+    // Use a new algorithm instance so that frame-by-frame processing starts from the same state
+    AhrsAlgo* perFrameAhrsAlgo = CreateAhrsAlgo(ahrsAlgoName);
+    std::vector<double> perFrameFilteredTiltSensorToTrackerMatrices;
+    double perFrameStartTimeSec = vtkTimerLog::GetUniversalTime();
+    ProcessFrames(perFrameAhrsAlgo, frameList, trackerReferenceFrame, parameters, perFrameFilteredTiltSensorToTrackerMatrices);
+    double perFrameTimeSec = vtkTimerLog::GetUniversalTime() - perFrameStartTimeSec;
+    delete perFrameAhrsAlgo;
+
+    double batchTimeSec = writtenTimeSec - startTimeSec;
+    int numberOfUpdates = samples.GetNumberOfSamples() + numberOfRepeatedFramesForInitialization;
+    LOG_INFO("Frame-by-frame processing time: " << perFrameTimeSec * 1000.0 << " ms (" << perFrameTimeSec * 1e6 / numberOfUpdates << " us/update)");
+    LOG_INFO("Batch processing time: " << batchTimeSec * 1000.0 << " ms (" << batchTimeSec * 1e6 / numberOfUpdates << " us/update; extract: "
+             << (extractedTimeSec - startTimeSec) * 1000.0 << " ms, process: " << (processedTimeSec - extractedTimeSec) * 1000.0
+             << " ms, write back: " << (writtenTimeSec - processedTimeSec) * 1000.0 << " ms)");
+    if (batchTimeSec > 0)
+    {
+      LOG_INFO("Speedup: " << perFrameTimeSec / batchTimeSec);
+    }
+
+    double maxDifference = 0;
+    for (size_t i = 0; i < filteredTiltSensorToTrackerMatrices.size(); i++)
+    {
+      maxDifference = std::max(maxDifference, fabs(filteredTiltSensorToTrackerMatrices[i] - perFrameFilteredTiltSensorToTrackerMatrices[i]));
+    }
+    LOG_INFO("Maximum difference between batch and frame-by-frame results: " << maxDifference);
+    if (maxDifference > DOUBLE_DIFF)
+    {
+      LOG_ERROR("Batch and frame-by-frame processing results are different");
+      return EXIT_FAILURE;
+    }
   }
 
   if (vtkPlusSequenceIO::Write(outputImgFile, frameList, US_IMG_ORIENT_XX) != PLUS_SUCCESS)
@@ -250,6 +459,552 @@ int main(int argc, char** argv)
 }
 
 
+//-----------------------------------------------------------------------------
+AhrsAlgo* CreateAhrsAlgo(const std::string& ahrsAlgoName)
+{
+  if (STRCASECMP("MADGWICK_IMU", ahrsAlgoName.c_str()) == 0)
+  {
+    return new MadgwickAhrsAlgo;
+  }
+  else if (STRCASECMP("MAHONY_IMU", ahrsAlgoName.c_str()) == 0)
+  {
+    return new MahonyAhrsAlgo;
+  }
+  LOG_ERROR("Unable to recognize AHRS algorithm type: " << ahrsAlgoName << ". Supported types: MADGWICK_IMU, MAHONY_IMU");
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+double GetSampleFreqHz(double firstTimestamp, double secondTimestamp)
+{
+  double samplingFreqHz = 125;
+  double timeDiffSec = fabs(secondTimestamp - firstTimestamp);
+  if (timeDiffSec > 1e-4)
+  {
+    samplingFreqHz = 1 / timeDiffSec;
+  }
+  return samplingFreqHz;
+}
+
+//-----------------------------------------------------------------------------
+void ExtractImuSamples(vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, ImuSamples& samples)
+{
+  int nFrames = frameList->GetNumberOfTrackedFrames();
+  samples.Timestamps.resize(nFrames);
+  samples.GyroscopeX.resize(nFrames);
+  samples.GyroscopeY.resize(nFrames);
+  samples.GyroscopeZ.resize(nFrames);
+  samples.AccelerometerX.resize(nFrames);
+  samples.AccelerometerY.resize(nFrames);
+  samples.AccelerometerZ.resize(nFrames);
+
+  igsioTransformName gyroscopeToTrackerTransformName("Gyroscope", trackerReferenceFrame);
+  igsioTransformName accelerometerToTrackerTransformName("Accelerometer", trackerReferenceFrame);
+  double gyroscopeMat[16];
+  double accelerometerMat[16];
+  for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    // Missing transforms are read as identity, same as in frame-by-frame processing
+    vtkMatrix4x4::Identity(gyroscopeMat);
+    frame->GetFrameTransform(gyroscopeToTrackerTransformName, gyroscopeMat);
+    vtkMatrix4x4::Identity(accelerometerMat);
+    frame->GetFrameTransform(accelerometerToTrackerTransformName, accelerometerMat);
+
+    samples.Timestamps[frameIndex] = frame->GetTimestamp();
+    samples.GyroscopeX[frameIndex] = vtkMath::RadiansFromDegrees(gyroscopeMat[3]);
+    samples.GyroscopeY[frameIndex] = vtkMath::RadiansFromDegrees(gyroscopeMat[7]);
+    samples.GyroscopeZ[frameIndex] = vtkMath::RadiansFromDegrees(gyroscopeMat[11]);
+    samples.AccelerometerX[frameIndex] = accelerometerMat[3];
+    samples.AccelerometerY[frameIndex] = accelerometerMat[7];
+    samples.AccelerometerZ[frameIndex] = accelerometerMat[11];
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Same computation as Update(), but takes the sensor data as values (gyroscope in rad/s) and uses the
+// caller-provided filteredTiltSensorToTrackerTransform as work matrix, so no memory is allocated.
+void UpdateSample(AhrsAlgo* ahrsAlgo, double gyroscopeX, double gyroscopeY, double gyroscopeZ, double accelerometerX, double accelerometerY, double accelerometerZ,
+                  double timestamp, int westAxisIndex, bool useTimestamps, vtkMatrix4x4* filteredTiltSensorToTrackerTransform)
+{
+  if (useTimestamps)
+  {
+    ahrsAlgo->UpdateIMUWithTimestamp(gyroscopeX, gyroscopeY, gyroscopeZ, accelerometerX, accelerometerY, accelerometerZ, timestamp);
+  }
+  else
+  {
+    ahrsAlgo->UpdateIMU(gyroscopeX, gyroscopeY, gyroscopeZ, accelerometerX, accelerometerY, accelerometerZ);
+  }
+
+  double rotQuat[4] = {0};
+  ahrsAlgo->GetOrientation(rotQuat[0], rotQuat[1], rotQuat[2], rotQuat[3]);
+
+  double rotMatrix[3][3] = {0};
+  vtkMath::QuaternionToMatrix3x3(rotQuat, rotMatrix);
+
+  double filteredDownVector_Sensor[4] = {rotMatrix[2][0], rotMatrix[2][1], rotMatrix[2][2], 0};
+  vtkMath::Normalize(filteredDownVector_Sensor);
+
+  igsioMath::ConstrainRotationToTwoAxes(filteredDownVector_Sensor, westAxisIndex, filteredTiltSensorToTrackerTransform);
+
+  // write back the results to the FilteredTiltSensor_AHRS algorithm
+  for (int c = 0; c < 3; c++)
+  {
+    for (int r = 0; r < 3; r++)
+    {
+      rotMatrix[r][c] = filteredTiltSensorToTrackerTransform->GetElement(r, c);
+    }
+  }
+  double filteredTiltSensorRotQuat[4] = {0};
+  vtkMath::Matrix3x3ToQuaternion(rotMatrix, filteredTiltSensorRotQuat);
+  ahrsAlgo->SetOrientation(filteredTiltSensorRotQuat[0], filteredTiltSensorRotQuat[1], filteredTiltSensorRotQuat[2], filteredTiltSensorRotQuat[3]);
+}
+
+//-----------------------------------------------------------------------------
+// The 16 elements of the filtered tilt sensor to tracker matrix of each sample are stored consecutively, in row-major order
+void ProcessImuSamples(AhrsAlgo* ahrsAlgo, const ImuSamples& samples, const AhrsParameters& parameters, std::vector<double>& filteredTiltSensorToTrackerMatrices)
+{
+  int numberOfSamples = samples.GetNumberOfSamples();
+  filteredTiltSensorToTrackerMatrices.resize(16 * numberOfSamples);
+  vtkSmartPointer<vtkMatrix4x4> filteredTiltSensorToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  // Initialization with the same frame
+  ahrsAlgo->SetGain(parameters.InitialProportionalGain, parameters.InitialIntegralGain);
+  ahrsAlgo->SetSampleFreqHz(GetSampleFreqHz(samples.Timestamps[0], samples.Timestamps[1]));
+  for (int i = 0; i < parameters.NumberOfRepeatedFramesForInitialization; i++)
+  {
+    UpdateSample(ahrsAlgo, samples.GyroscopeX[0], samples.GyroscopeY[0], samples.GyroscopeZ[0], samples.AccelerometerX[0], samples.AccelerometerY[0], samples.AccelerometerZ[0],
+                 samples.Timestamps[0], parameters.WestAxisIndex, false, filteredTiltSensorToTrackerTransform);
+  }
+
+  //set gain to normal running value after convergence time
+  ahrsAlgo->SetGain(parameters.ProportionalGain, parameters.IntegralGain);
+  for (int sampleIndex = 0; sampleIndex < numberOfSamples; sampleIndex++)
+  {
+    UpdateSample(ahrsAlgo, samples.GyroscopeX[sampleIndex], samples.GyroscopeY[sampleIndex], samples.GyroscopeZ[sampleIndex],
+                 samples.AccelerometerX[sampleIndex], samples.AccelerometerY[sampleIndex], samples.AccelerometerZ[sampleIndex],
+                 samples.Timestamps[sampleIndex], parameters.WestAxisIndex, true, filteredTiltSensorToTrackerTransform);
+    vtkMatrix4x4::DeepCopy(&filteredTiltSensorToTrackerMatrices[16 * sampleIndex], filteredTiltSensorToTrackerTransform);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SetFilteredTiltSensorTransforms(vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, const std::vector<double>& filteredTiltSensorToTrackerMatrices)
+{
+  igsioTransformName filteredTiltSensorToTrackerTransformName("FilteredTiltSensor", trackerReferenceFrame);
+  vtkSmartPointer<vtkMatrix4x4> filteredTiltSensorToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  int nFrames = frameList->GetNumberOfTrackedFrames();
+  for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    filteredTiltSensorToTrackerTransform->DeepCopy(&filteredTiltSensorToTrackerMatrices[16 * frameIndex]);
+    frame->SetFrameTransform(filteredTiltSensorToTrackerTransformName, filteredTiltSensorToTrackerTransform);
+    frame->SetFrameTransformStatus(filteredTiltSensorToTrackerTransformName, TOOL_OK);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Frame-by-frame processing: reads the sensor data from each frame and writes the result back immediately.
+// Kept as reference for benchmarking the batch processing.
+void ProcessFrames(AhrsAlgo* ahrsAlgo, vtkIGSIOTrackedFrameList* frameList, const std::string& trackerReferenceFrame, const AhrsParameters& parameters, std::vector<double>& filteredTiltSensorToTrackerMatrices)
+{
+  // Initialization with the same frame
+  ahrsAlgo->SetGain(parameters.InitialProportionalGain, parameters.InitialIntegralGain);
+  igsioTrackedFrame* frame0 = frameList->GetTrackedFrame(0);
+  igsioTrackedFrame* frame1 = frameList->GetTrackedFrame(1);
+  ahrsAlgo->SetSampleFreqHz(GetSampleFreqHz(frame0->GetTimestamp(), frame1->GetTimestamp()));
+  for (int frameIndex = 0; frameIndex < parameters.NumberOfRepeatedFramesForInitialization; frameIndex++)
+  {
+    Update(ahrsAlgo, frame0, trackerReferenceFrame, parameters.WestAxisIndex, false);
+  }
+
+  //set gain to normal running value after convergence time
+  ahrsAlgo->SetGain(parameters.ProportionalGain, parameters.IntegralGain);
+  int nFrames = frameList->GetNumberOfTrackedFrames();
+  filteredTiltSensorToTrackerMatrices.resize(16 * nFrames);
+  vtkSmartPointer<vtkMatrix4x4> filteredTiltSensorToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    Update(ahrsAlgo, frame, trackerReferenceFrame, parameters.WestAxisIndex, true, filteredTiltSensorToTrackerTransform);
+    frame->SetFrameTransform(igsioTransformName("FilteredTiltSensor", trackerReferenceFrame), filteredTiltSensorToTrackerTransform);
+    frame->SetFrameTransformStatus(igsioTransformName("FilteredTiltSensor", trackerReferenceFrame), TOOL_OK);
+    vtkMatrix4x4::DeepCopy(&filteredTiltSensorToTrackerMatrices[16 * frameIndex], filteredTiltSensorToTrackerTransform);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Returns the angle of the rotation between the rotation parts of two row-major 4x4 matrices
+double GetRotationDifferenceDeg(const double* matrixA, const double* matrixB)
+{
+  // trace(A^T * B) = 1 + 2 * cos(angle)
+  double trace = 0;
+  for (int r = 0; r < 3; r++)
+  {
+    for (int c = 0; c < 3; c++)
+    {
+      trace += matrixA[4 * r + c] * matrixB[4 * r + c];
+    }
+  }
+  double cosAngle = std::max(-1.0, std::min(1.0, (trace - 1.0) / 2.0));
+  return vtkMath::DegreesFromRadians(acos(cosAngle));
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus RunGainSweep(vtkIGSIOTrackedFrameList* frameList, vtkIGSIOTrackedFrameList* referenceFrameList, const igsioTransformName& referenceTransformName,
+                        const std::string& trackerReferenceFrame, std::vector<SweepConfiguration>& configurations, int numberOfThreads, const std::string& outputFileName)
+{
+  int nFrames = frameList->GetNumberOfTrackedFrames();
+  if (static_cast<int>(referenceFrameList->GetNumberOfTrackedFrames()) < nFrames)
+  {
+    LOG_ERROR("The reference sequence has fewer frames (" << referenceFrameList->GetNumberOfTrackedFrames() << ") than the input sequence (" << nFrames << ")");
+    return PLUS_FAIL;
+  }
+
+  // Sensor data and reference orientations are extracted once and shared read-only by all workers
+  ImuSamples samples;
+  ExtractImuSamples(frameList, trackerReferenceFrame, samples);
+  std::vector<double> referenceMatrices(16 * nFrames);
+  std::vector<bool> referenceValid(nFrames);
+  int numberOfValidReferenceFrames = 0;
+  for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+  {
+    igsioTrackedFrame* referenceFrame = referenceFrameList->GetTrackedFrame(frameIndex);
+    ToolStatus status = TOOL_INVALID;
+    referenceValid[frameIndex] = referenceFrame->GetFrameTransform(referenceTransformName, &referenceMatrices[16 * frameIndex]) == IGSIO_SUCCESS
+                                 && referenceFrame->GetFrameTransformStatus(referenceTransformName, status) == IGSIO_SUCCESS && status == TOOL_OK;
+    if (referenceValid[frameIndex])
+    {
+      numberOfValidReferenceFrames++;
+    }
+  }
+  if (numberOfValidReferenceFrames == 0)
+  {
+    LOG_ERROR("No valid " << referenceTransformName.GetTransformName() << " reference transform is found");
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Evaluate " << configurations.size() << " configurations on " << nFrames << " frames...");
+
+  double startTimeSec = vtkTimerLog::GetUniversalTime();
+  std::atomic<size_t> nextConfigurationIndex(0);
+  auto worker = [&]()
+  {
+    // Each worker reuses its result buffer, the algorithm instance is created for each configuration
+    std::vector<double> filteredTiltSensorToTrackerMatrices;
+    for (size_t configurationIndex = nextConfigurationIndex++; configurationIndex < configurations.size(); configurationIndex = nextConfigurationIndex++)
+    {
+      SweepConfiguration& configuration = configurations[configurationIndex];
+      AhrsAlgo* ahrsAlgo = CreateAhrsAlgo(configuration.AhrsAlgoName);
+      ProcessImuSamples(ahrsAlgo, samples, configuration.Parameters, filteredTiltSensorToTrackerMatrices);
+      delete ahrsAlgo;
+
+      double sumErrorDeg = 0;
+      for (int frameIndex = 0; frameIndex < nFrames; frameIndex++)
+      {
+        if (!referenceValid[frameIndex])
+        {
+          continue;
+        }
+        double errorDeg = GetRotationDifferenceDeg(&filteredTiltSensorToTrackerMatrices[16 * frameIndex], &referenceMatrices[16 * frameIndex]);
+        sumErrorDeg += errorDeg;
+        configuration.MaxErrorDeg = std::max(configuration.MaxErrorDeg, errorDeg);
+      }
+      configuration.NumberOfComparedFrames = numberOfValidReferenceFrames;
+      configuration.MeanErrorDeg = sumErrorDeg / numberOfValidReferenceFrames;
+    }
+  };
+
+  numberOfThreads = std::max(1, std::min(numberOfThreads, static_cast<int>(configurations.size())));
+  std::vector<std::thread> threads;
+  for (int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    threads.push_back(std::thread(worker));
+  }
+  // The calling thread is one of the workers
+  worker();
+  for (std::vector<std::thread>::iterator threadIt = threads.begin(); threadIt != threads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+  LOG_INFO("Sweep completed in " << vtkTimerLog::GetUniversalTime() - startTimeSec << " s using " << numberOfThreads << " threads");
+
+  std::stable_sort(configurations.begin(), configurations.end(), [](const SweepConfiguration & a, const SweepConfiguration & b)
+  {
+    return a.MeanErrorDeg < b.MeanErrorDeg;
+  });
+  for (std::vector<SweepConfiguration>::iterator configurationIt = configurations.begin(); configurationIt != configurations.end(); ++configurationIt)
+  {
+    LOG_INFO(configurationIt->AhrsAlgoName << " gain: " << configurationIt->Parameters.ProportionalGain << " " << configurationIt->Parameters.IntegralGain
+             << ", initial gain: " << configurationIt->Parameters.InitialProportionalGain << ", initial frames: " << configurationIt->Parameters.NumberOfRepeatedFramesForInitialization
+             << " - mean error: " << configurationIt->MeanErrorDeg << " deg, max error: " << configurationIt->MaxErrorDeg << " deg");
+  }
+
+  if (!outputFileName.empty())
+  {
+    std::ofstream outputFile(outputFileName.c_str());
+    if (!outputFile.is_open())
+    {
+      LOG_ERROR("Unable to open sweep output file: " << outputFileName);
+      return PLUS_FAIL;
+    }
+    outputFile << "AhrsAlgo,ProportionalGain,IntegralGain,InitialProportionalGain,InitialIntegralGain,InitialRepeatedFrameNumber,MeanErrorDeg,MaxErrorDeg,NumberOfComparedFrames" << std::endl;
+    for (std::vector<SweepConfiguration>::iterator configurationIt = configurations.begin(); configurationIt != configurations.end(); ++configurationIt)
+    {
+      outputFile << configurationIt->AhrsAlgoName << "," << configurationIt->Parameters.ProportionalGain << "," << configurationIt->Parameters.IntegralGain
+                 << "," << configurationIt->Parameters.InitialProportionalGain << "," << configurationIt->Parameters.InitialIntegralGain
+                 << "," << configurationIt->Parameters.NumberOfRepeatedFramesForInitialization << "," << configurationIt->MeanErrorDeg
+                 << "," << configurationIt->MaxErrorDeg << "," << configurationIt->NumberOfComparedFrames << std::endl;
+    }
+    LOG_INFO("Sweep results written to " << outputFileName);
+  }
+
+  return PLUS_SUCCESS;
+}
+#ifdef PLUS_USE_OpenIGTLink
+/*! Update rate requested from the server in live mode */
+static const int LIVE_TRACKING_DATA_RESOLUTION_MSEC = 5;
+/*! Time between processing time reports in live mode */
+static const double LIVE_REPORT_INTERVAL_SEC = 5.0;
+
+//-----------------------------------------------------------------------------
+// Returns the name of a transform received in a tracking data element or transform message.
+// PlusServer sends full transform names (e.g., GyroscopeToTracker), other servers may only send the tool name,
+// then the message device name is used as the To coordinate frame.
+std::string GetReceivedTransformName(const std::string& name, const std::string& deviceName)
+{
+  igsioTransformName transformName;
+  if (transformName.SetTransformName(name) == IGSIO_SUCCESS)
+  {
+    return name;
+  }
+  return name + "To" + deviceName;
+}
+
+//-----------------------------------------------------------------------------
+// Receives the Gyroscope and Accelerometer transforms (TDATA or TRANSFORM messages) from an OpenIGTLink server.
+// Each time both sensors are updated, the filtered tilt is computed and sent back to the server in a TRANSFORM message
+// with the timestamp of the sensor data. Messages are processed one by one, without buffering, so the latency is
+// the processing time of a single sample, which is reported periodically.
+PlusStatus RunLiveFusion(const std::string& hostname, int port, double durationSec, AhrsAlgo* ahrsAlgo, const AhrsParameters& parameters, const std::string& trackerReferenceFrame)
+{
+  igtl::ClientSocket::Pointer socket = igtl::ClientSocket::New();
+  if (socket->ConnectToServer(hostname.c_str(), port) != 0)
+  {
+    LOG_ERROR("Cannot connect to the server at " << hostname << ":" << port);
+    return PLUS_FAIL;
+  }
+  // Receive with timeout, so that the processing time is reported and the duration is checked even if no data arrives
+  socket->SetReceiveTimeout(1000);
+
+  igtl::StartTrackingDataMessage::Pointer startTracking = igtl::StartTrackingDataMessage::New();
+  startTracking->SetDeviceName("SpatialSensorFusion");
+  startTracking->SetResolution(LIVE_TRACKING_DATA_RESOLUTION_MSEC);
+  startTracking->Pack();
+  socket->Send(startTracking->GetBufferPointer(), startTracking->GetBufferSize());
+  LOG_INFO("Connected to " << hostname << ":" << port << ", receiving sensor data...");
+
+  const std::string gyroscopeToTrackerTransformName = igsioTransformName("Gyroscope", trackerReferenceFrame).GetTransformName();
+  const std::string accelerometerToTrackerTransformName = igsioTransformName("Accelerometer", trackerReferenceFrame).GetTransformName();
+  const std::string filteredTiltSensorToTrackerTransformName = igsioTransformName("FilteredTiltSensor", trackerReferenceFrame).GetTransformName();
+
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  igtl::TrackingDataMessage::Pointer trackingMsg = igtl::TrackingDataMessage::New();
+  igtl::TransformMessage::Pointer transformMsg = igtl::TransformMessage::New();
+  igtl::TransformMessage::Pointer filteredTiltSensorToTrackerMsg = igtl::TransformMessage::New();
+  filteredTiltSensorToTrackerMsg->SetDeviceName(filteredTiltSensorToTrackerTransformName.c_str());
+  igtl::TimeStamp::Pointer sampleTimestamp = igtl::TimeStamp::New();
+  vtkSmartPointer<vtkMatrix4x4> filteredTiltSensorToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  double gyroscope[3] = {0};
+  double accelerometer[3] = {0};
+  bool gyroscopeUpdated = false;
+  bool accelerometerUpdated = false;
+  bool initialized = false;
+  int numberOfSamples = 0;
+  bool streamError = false;
+  double maxProcessingTimeSec = 0;
+  int numberOfReportSamples = 0;
+  double sumReportProcessingTimeSec = 0;
+  double maxReportProcessingTimeSec = 0;
+
+  const double startTimeSec = vtkTimerLog::GetUniversalTime();
+  double lastReportTimeSec = startTimeSec;
+  while (durationSec <= 0 || vtkTimerLog::GetUniversalTime() - startTimeSec < durationSec)
+  {
+    const double nowSec = vtkTimerLog::GetUniversalTime();
+    if (nowSec - lastReportTimeSec >= LIVE_REPORT_INTERVAL_SEC)
+    {
+      if (numberOfReportSamples > 0)
+      {
+        LOG_INFO(numberOfReportSamples / (nowSec - lastReportTimeSec) << " samples/s, processing time per sample: mean "
+                 << sumReportProcessingTimeSec * 1e6 / numberOfReportSamples << " us, max " << maxReportProcessingTimeSec * 1e6 << " us");
+      }
+      numberOfReportSamples = 0;
+      sumReportProcessingTimeSec = 0;
+      maxReportProcessingTimeSec = 0;
+      lastReportTimeSec = nowSec;
+    }
+
+    headerMsg->InitBuffer();
+    bool timeout(false);
+    igtlUint64 rs = socket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize(), timeout);
+    if (timeout)
+    {
+      continue;
+    }
+    if (rs == 0)
+    {
+      LOG_INFO("Connection closed by the server");
+      break;
+    }
+    if (rs != headerMsg->GetBufferSize())
+    {
+      continue;
+    }
+    headerMsg->Unpack();
+
+    if (strcmp(headerMsg->GetDeviceType(), "TDATA") == 0)
+    {
+      trackingMsg->SetMessageHeader(headerMsg);
+      trackingMsg->AllocateBuffer();
+      rs = socket->Receive(trackingMsg->GetBufferBodyPointer(), trackingMsg->GetBufferBodySize(), timeout);
+      if (rs != trackingMsg->GetBufferBodySize())
+      {
+        // The rest of the stream cannot be interpreted after a partially received message
+        LOG_ERROR("Incomplete message body received (" << rs << " of " << trackingMsg->GetBufferBodySize() << " bytes)");
+        streamError = true;
+        break;
+      }
+      if (!(trackingMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+      {
+        continue;
+      }
+      for (int i = 0; i < trackingMsg->GetNumberOfTrackingDataElements(); ++i)
+      {
+        igtl::TrackingDataElement::Pointer trackingElement;
+        trackingMsg->GetTrackingDataElement(i, trackingElement);
+        std::string transformName = GetReceivedTransformName(trackingElement->GetName(), headerMsg->GetDeviceName());
+        igtl::Matrix4x4 matrix;
+        if (transformName == gyroscopeToTrackerTransformName)
+        {
+          trackingElement->GetMatrix(matrix);
+          gyroscope[0] = vtkMath::RadiansFromDegrees(matrix[0][3]);
+          gyroscope[1] = vtkMath::RadiansFromDegrees(matrix[1][3]);
+          gyroscope[2] = vtkMath::RadiansFromDegrees(matrix[2][3]);
+          gyroscopeUpdated = true;
+        }
+        else if (transformName == accelerometerToTrackerTransformName)
+        {
+          trackingElement->GetMatrix(matrix);
+          accelerometer[0] = matrix[0][3];
+          accelerometer[1] = matrix[1][3];
+          accelerometer[2] = matrix[2][3];
+          accelerometerUpdated = true;
+        }
+      }
+    }
+    else if (strcmp(headerMsg->GetDeviceType(), "TRANSFORM") == 0)
+    {
+      std::string transformName = GetReceivedTransformName(headerMsg->GetDeviceName(), trackerReferenceFrame);
+      if (transformName != gyroscopeToTrackerTransformName && transformName != accelerometerToTrackerTransformName)
+      {
+        socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+        continue;
+      }
+      transformMsg->SetMessageHeader(headerMsg);
+      transformMsg->AllocateBuffer();
+      rs = socket->Receive(transformMsg->GetBufferBodyPointer(), transformMsg->GetBufferBodySize(), timeout);
+      if (rs != transformMsg->GetBufferBodySize())
+      {
+        LOG_ERROR("Incomplete message body received (" << rs << " of " << transformMsg->GetBufferBodySize() << " bytes)");
+        streamError = true;
+        break;
+      }
+      if (!(transformMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+      {
+        continue;
+      }
+      igtl::Matrix4x4 matrix;
+      transformMsg->GetMatrix(matrix);
+      if (transformName == gyroscopeToTrackerTransformName)
+      {
+        gyroscope[0] = vtkMath::RadiansFromDegrees(matrix[0][3]);
+        gyroscope[1] = vtkMath::RadiansFromDegrees(matrix[1][3]);
+        gyroscope[2] = vtkMath::RadiansFromDegrees(matrix[2][3]);
+        gyroscopeUpdated = true;
+      }
+      else
+      {
+        accelerometer[0] = matrix[0][3];
+        accelerometer[1] = matrix[1][3];
+        accelerometer[2] = matrix[2][3];
+        accelerometerUpdated = true;
+      }
+    }
+    else
+    {
+      socket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      continue;
+    }
+
+    // A sample is complete when both sensors are updated
+    if (!gyroscopeUpdated || !accelerometerUpdated)
+    {
+      continue;
+    }
+    gyroscopeUpdated = false;
+    accelerometerUpdated = false;
+    headerMsg->GetTimeStamp(sampleTimestamp);
+
+    if (!initialized)
+    {
+      // Initialization with the first sample, same as with the first frame of a sequence file
+      ahrsAlgo->SetGain(parameters.InitialProportionalGain, parameters.InitialIntegralGain);
+      ahrsAlgo->SetSampleFreqHz(1000.0 / LIVE_TRACKING_DATA_RESOLUTION_MSEC);
+      for (int i = 0; i < parameters.NumberOfRepeatedFramesForInitialization; i++)
+      {
+        UpdateSample(ahrsAlgo, gyroscope[0], gyroscope[1], gyroscope[2], accelerometer[0], accelerometer[1], accelerometer[2],
+                     sampleTimestamp->GetTimeStamp(), parameters.WestAxisIndex, false, filteredTiltSensorToTrackerTransform);
+      }
+      ahrsAlgo->SetGain(parameters.ProportionalGain, parameters.IntegralGain);
+      initialized = true;
+    }
+
+    double processingStartTimeSec = vtkTimerLog::GetUniversalTime();
+    UpdateSample(ahrsAlgo, gyroscope[0], gyroscope[1], gyroscope[2], accelerometer[0], accelerometer[1], accelerometer[2],
+                 sampleTimestamp->GetTimeStamp(), parameters.WestAxisIndex, true, filteredTiltSensorToTrackerTransform);
+    igtl::Matrix4x4 filteredTiltSensorToTrackerMatrix;
+    for (int r = 0; r < 4; r++)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        filteredTiltSensorToTrackerMatrix[r][c] = static_cast<float>(filteredTiltSensorToTrackerTransform->GetElement(r, c));
+      }
+    }
+    filteredTiltSensorToTrackerMsg->SetMatrix(filteredTiltSensorToTrackerMatrix);
+    filteredTiltSensorToTrackerMsg->SetTimeStamp(sampleTimestamp);
+    filteredTiltSensorToTrackerMsg->Pack();
+    socket->Send(filteredTiltSensorToTrackerMsg->GetBufferPointer(), filteredTiltSensorToTrackerMsg->GetBufferSize());
+    double processingTimeSec = vtkTimerLog::GetUniversalTime() - processingStartTimeSec;
+
+    numberOfSamples++;
+    maxProcessingTimeSec = std::max(maxProcessingTimeSec, processingTimeSec);
+    numberOfReportSamples++;
+    sumReportProcessingTimeSec += processingTimeSec;
+    maxReportProcessingTimeSec = std::max(maxReportProcessingTimeSec, processingTimeSec);
+  }
+
+  igtl::StopTrackingDataMessage::Pointer stopTracking = igtl::StopTrackingDataMessage::New();
+  stopTracking->SetDeviceName("SpatialSensorFusion");
+  stopTracking->Pack();
+  socket->Send(stopTracking->GetBufferPointer(), stopTracking->GetBufferSize());
+  socket->CloseSocket();
+  LOG_INFO("Processed " << numberOfSamples << " samples, maximum processing time per sample: " << maxProcessingTimeSec * 1e6 << " us");
+  return streamError ? PLUS_FAIL : PLUS_SUCCESS;
+}
+#endif
+
+//-----------------------------------------------------------------------------
 void Update(AhrsAlgo* ahrsAlgo, igsioTrackedFrame* frame, const std::string& trackerReferenceFrame, int westAxisIndex, bool useTimestamps, vtkMatrix4x4* filteredTiltSensorToTrackerTransformReturn/*=NULL*/)
 {
   double timestamp = frame->GetTimestamp();
@@ -27,7 +27,9 @@ See License.txt for details.
 #include <QScrollArea>
 #include <QSpacerItem>
 #include <QString>
-#include <QTimer>
+
+// STL includes
+#include <chrono>
 
 static const int MAX_ALLOWED_RECORDING_LAG_SEC = 3.0; // if the recording lags more than this then it'll skip frames to catch up
 
@@ -36,7 +38,9 @@ QCapturingToolbox::QCapturingToolbox(fCalMainWindow* aParentMainWindow, Qt::Wind
   : QAbstractToolbox(aParentMainWindow)
   , QWidget(aParentMainWindow, aFlags)
   , m_RecordedFrames(NULL)
-  , m_RecordingTimer(NULL)
+  , m_RecordingStopRequested(false)
+  , m_RecordingChannel(NULL)
+  , m_NumberOfRecordedFrames(0)
   , m_RecordingLastAlreadyRecordedFrameTimestamp(UNDEFINED_TIMESTAMP)
   , m_RecordingNextFrameToBeRecordedTimestamp(0.0)
   , m_SamplingFrameRate(8)
@@ -60,10 +64,6 @@ QCapturingToolbox::QCapturingToolbox(fCalMainWindow* aParentMainWindow, Qt::Wind
   connect(ui.pushButton_StartStopAll, SIGNAL(clicked()), this, SLOT(StartStopAll()));
   connect(ui.horizontalSlider_SamplingRate, SIGNAL(valueChanged(int)), this, SLOT(SamplingRateChanged(int)));
 
-  // Create and connect recording timer
-  m_RecordingTimer = new QTimer(this);
-  connect(m_RecordingTimer, SIGNAL(timeout()), this, SLOT(Capture()));
-
   ui.pushButton_Save->setEnabled(m_RecordedFrames->GetNumberOfTrackedFrames() > 0);
   ui.pushButton_SaveAs->setEnabled(m_RecordedFrames->GetNumberOfTrackedFrames() > 0);
 
@@ -77,6 +77,8 @@ QCapturingToolbox::QCapturingToolbox(fCalMainWindow* aParentMainWindow, Qt::Wind
 //-----------------------------------------------------------------------------
 QCapturingToolbox::~QCapturingToolbox()
 {
+  StopRecordingThread();
+
   if (m_RecordedFrames != NULL)
   {
     m_RecordedFrames->Delete();
@@ -117,8 +119,8 @@ void QCapturingToolbox::RefreshContent()
 
   if (m_State == ToolboxState_InProgress)
   {
-    ui.label_ActualRecordingFrameRate->setText(QString::number(m_ActualFrameRate, 'f', 2));
-    ui.label_NumberOfRecordedFrames->setText(QString::number(m_RecordedFrames->GetNumberOfTrackedFrames()));
+    ui.label_ActualRecordingFrameRate->setText(QString::number(m_ActualFrameRate.load(), 'f', 2));
+    ui.label_NumberOfRecordedFrames->setText(QString::number(m_NumberOfRecordedFrames.load()));
   }
 
   ui.pushButton_SaveAll->setEnabled(false);
@@ -380,37 +382,71 @@ void QCapturingToolbox::Record()
 {
   LOG_INFO("Capturing started");
 
+  m_RecordingChannel = m_ParentMainWindow->GetSelectedChannel();
+  if (m_RecordingChannel == NULL)
+  {
+    LOG_ERROR("Unable to reach valid data collector object!");
+    return;
+  }
+
   m_ParentMainWindow->SetToolboxesEnabled(false);
   m_ActualFrameRate = 0.0; // display 0.00 until a real estimation is available
 
   // Reset accessory members
   m_RecordingFirstFrameIndexInThisSegment = m_RecordedFrames->GetNumberOfTrackedFrames();
+  m_NumberOfRecordedFrames = m_RecordedFrames->GetNumberOfTrackedFrames();
 
   ui.plainTextEdit_saveResult->clear();
 
   m_RecordingNextFrameToBeRecordedTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
   m_RecordingLastAlreadyRecordedFrameTimestamp = UNDEFINED_TIMESTAMP; // none yet
 
-  // Start capturing
+  // Start capturing on the recording thread, so that rendering and user interaction cannot delay it
   SetState(ToolboxState_InProgress);
-  double samplingPeriodMsec = GetSamplingPeriodSec() * 1000.0;
-  m_RecordingTimer->start(samplingPeriodMsec);
+  m_RecordingStopRequested = false;
+  m_RecordingThread = std::thread(&QCapturingToolbox::RecordingLoop, this);
 }
 
 //-----------------------------------------------------------------------------
-void QCapturingToolbox::Capture()
+void QCapturingToolbox::RecordingLoop()
 {
-  //LOG_TRACE("CapturingToolbox::Capture");
+  const double samplingPeriodSec = GetSamplingPeriodSec();
 
-  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  while (!m_RecordingStopRequested)
+  {
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+
+    Capture();
+
+    // Wait for the rest of the sampling period
+    double remainingTimeSec = samplingPeriodSec - (vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec);
+    if (remainingTimeSec > 0)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(remainingTimeSec * 1000000.0)));
+    }
+  }
+}
 
-  vtkPlusDataCollector* dataCollector = NULL;
-  if ((m_ParentMainWindow == NULL) || (m_ParentMainWindow->GetVisualizationController() == NULL) || ((dataCollector = m_ParentMainWindow->GetVisualizationController()->GetDataCollector()) == NULL))
+//-----------------------------------------------------------------------------
+void QCapturingToolbox::StopRecordingThread()
+{
+  if (!m_RecordingThread.joinable())
   {
-    LOG_ERROR("Unable to reach valid data collector object!");
     return;
   }
 
+  m_RecordingStopRequested = true;
+  m_RecordingThread.join();
+  m_RecordingChannel = NULL;
+}
+
+//-----------------------------------------------------------------------------
+void QCapturingToolbox::Capture()
+{
+  //LOG_TRACE("CapturingToolbox::Capture");
+
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+
   // Record
   double maxProcessingTimeSec = GetSamplingPeriodSec() * 2.0; // put a hard limit on the max processing time to make sure the application remains responsive during recording
   double requestedFramePeriodSec = 0.1;
@@ -423,11 +459,12 @@ void QCapturingToolbox::Capture()
     LOG_WARNING("RequestedFrameRate is invalid");
   }
   int nbFramesBefore = m_RecordedFrames->GetNumberOfTrackedFrames();
-  if (m_ParentMainWindow->GetSelectedChannel()->GetTrackedFrameListSampled(m_RecordingLastAlreadyRecordedFrameTimestamp, m_RecordingNextFrameToBeRecordedTimestamp, m_RecordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
+  if (m_RecordingChannel->GetTrackedFrameListSampled(m_RecordingLastAlreadyRecordedFrameTimestamp, m_RecordingNextFrameToBeRecordedTimestamp, m_RecordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
   {
     LOG_ERROR("Error while getting tracked frame list from data collector during capturing. Last recorded timestamp: " << std::fixed << m_RecordingNextFrameToBeRecordedTimestamp);
   }
   int nbFramesAfter = m_RecordedFrames->GetNumberOfTrackedFrames();
+  m_NumberOfRecordedFrames = nbFramesAfter;
 
   // Compute the average frame rate from the ratio of recently acquired frames
   int frame1Index = m_RecordedFrames->GetNumberOfTrackedFrames() - 1; // index of the latest frame
@@ -474,7 +511,7 @@ void QCapturingToolbox::Stop()
 {
   LOG_INFO("Capturing stopped");
 
-  m_RecordingTimer->stop();
+  StopRecordingThread();
   SetState(ToolboxState_Done);
 
   m_ParentMainWindow->SetToolboxesEnabled(true);
@@ -610,6 +647,8 @@ double QCapturingToolbox::GetMaximumFrameRate()
 //-----------------------------------------------------------------------------
 void QCapturingToolbox::Reset()
 {
+  StopRecordingThread();
+
   QAbstractToolbox::Reset();
 
   this->ClearRecordedFramesInternal();
@@ -17,13 +17,17 @@ See License.txt for details.
 // Qt includes
 #include <QWidget>
 
+// STL includes
+#include <atomic>
+#include <thread>
+
 class PlusCaptureControlWidget;
 class QGridLayout;
 class QScrollArea;
 class QSpacerItem;
 class QString;
-class QTimer;
 class vtkIGSIOTrackedFrameList;
+class vtkPlusChannel;
 
 //-----------------------------------------------------------------------------
 
@@ -95,6 +99,21 @@ protected:
   /// Initialize the scroll area and any capture widgets
   void InitCaptureDeviceScrollArea();
 
+  /*!
+  * Record tracked frames (the recording thread calls it once in every sampling period)
+  */
+  void Capture();
+
+  /*!
+  * Recording loop that runs on the recording thread, independently from the rendering on the GUI thread
+  */
+  void RecordingLoop();
+
+  /*!
+  * Stop the recording thread and wait for it to finish
+  */
+  void StopRecordingThread();
+
 protected slots:
   /*!
   * Take snapshot (record the current frame only)
@@ -147,11 +166,6 @@ protected slots:
   */
   void SamplingRateChanged(int aValue);
 
-  /*!
-  * Record tracked frames (the recording timer calls it)
-  */
-  void Capture();
-
   /*!
   * Handle status message from any sub capture widgets
   */
@@ -161,8 +175,17 @@ protected:
   /*! Recorded tracked frame list */
   vtkIGSIOTrackedFrameList* m_RecordedFrames;
 
-  /*! Timer triggering the */
-  QTimer* m_RecordingTimer;
+  /*! Thread recording the frames. The recorded frame list must not be accessed by other threads while it is running. */
+  std::thread m_RecordingThread;
+
+  /*! Flag signaling the recording thread to finish */
+  std::atomic<bool> m_RecordingStopRequested;
+
+  /*! Channel the recording thread records from */
+  vtkPlusChannel* m_RecordingChannel;
+
+  /*! Number of recorded frames, updated by the recording thread for display */
+  std::atomic<int> m_NumberOfRecordedFrames;
 
   /*! Timestamp of last recorded frame (only frames that have more recent timestamp will be added) */
   double m_RecordingLastAlreadyRecordedFrameTimestamp;
@@ -176,8 +199,8 @@ protected:
   /*! Requested frame rate (frames per second) */
   double m_RequestedFrameRate;
 
-  /*! Actual frame rate (frames per second) */
-  double m_ActualFrameRate;
+  /*! Actual frame rate (frames per second), updated by the recording thread */
+  std::atomic<double> m_ActualFrameRate;
 
   /*!
     Frame index of the first frame that is recorded in this segment (since pressed the record button).
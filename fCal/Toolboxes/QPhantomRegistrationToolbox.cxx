@@ -36,6 +36,9 @@ See License.txt for details.
 #include <vtkSphereSource.h>
 #include <vtkXMLUtilities.h>
 
+// STL includes
+#include <limits>
+
 //-----------------------------------------------------------------------------
 QPhantomRegistrationToolbox::QPhantomRegistrationToolbox(fCalMainWindow* aParentMainWindow, Qt::WindowFlags aFlags)
   : QAbstractToolbox(aParentMainWindow)
@@ -52,6 +55,7 @@ QPhantomRegistrationToolbox::QPhantomRegistrationToolbox(fCalMainWindow* aParent
   , m_LandmarkPivotingState(LandmarkPivotingState_Incomplete)
   , m_PreviousStylusTipToReferenceTransformMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
   , m_LandmarkDetected(-1)
+  , m_LastProcessedSnapshotTimestamp(-std::numeric_limits<double>::max())
 {
   ui.setupUi(this);
 
@@ -1007,6 +1011,7 @@ void QPhantomRegistrationToolbox::StartLinearObjectRegistration()
   SetLinearObjectRegistrationState(LinearObjectRegistrationState_InProgress);
 
   m_CurrentPointNumber = 0;
+  m_LastProcessedSnapshotTimestamp = -std::numeric_limits<double>::max();
 
   // Clear result points
   m_ParentMainWindow->GetVisualizationController()->ClearResultPolyData();
@@ -1080,6 +1085,7 @@ void QPhantomRegistrationToolbox::StartLandmarkDetectionRegistration()
 
   ui.tabWidget->setTabEnabled(1, false);
   ui.pushButton_StartStop_LandmarkDetection->setText(tr("Stop Detection"));
+  m_LastProcessedSnapshotTimestamp = -std::numeric_limits<double>::max();
 
   if (m_State == ToolboxState_Done || m_LandmarkPivotingState != LandmarkPivotingState_InProgress)
   {
@@ -1147,14 +1153,54 @@ void QPhantomRegistrationToolbox::StopLandmarkPivotingRegistration()
   }
 }
 
+//-----------------------------------------------------------------------------
+void QPhantomRegistrationToolbox::GetNewTrackedFrameSnapshots(std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& aSnapshots)
+{
+  aSnapshots.clear();
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> > snapshots = m_ParentMainWindow->GetVisualizationController()->GetAcquiredTrackedFrameSnapshots();
+  if (snapshots.empty())
+  {
+    snapshots.push_back(m_ParentMainWindow->GetVisualizationController()->GetTrackedFrameSnapshot());
+  }
+
+  for (std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >::iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+  {
+    // The snapshots of a tick may be offered again if the slot is called before the controller is updated
+    if ((*it)->IsValid())
+    {
+      if ((*it)->GetTimestamp() <= m_LastProcessedSnapshotTimestamp)
+      {
+        continue;
+      }
+      m_LastProcessedSnapshotTimestamp = (*it)->GetTimestamp();
+    }
+    aSnapshots.push_back(*it);
+  }
+}
+
 //-----------------------------------------------------------------------------
 void QPhantomRegistrationToolbox::AddStylusTipTransformToLandmarkPivotingRegistration()
+{
+  LOG_TRACE("PhantomRegistrationToolbox::AddStylusTipTransformToLandmarkPivotingRegistration");
+
+  // Process all positions acquired since the previous tick, so that the detection keeps up with the tracker rate
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> > snapshots;
+  GetNewTrackedFrameSnapshots(snapshots);
+  for (std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >::iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+  {
+    AddStylusTipPositionToLandmarkPivotingRegistration(*it);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void QPhantomRegistrationToolbox::AddStylusTipPositionToLandmarkPivotingRegistration(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot)
 {
   LOG_TRACE("PhantomRegistrationToolbox::AddStylusTipPositionToLandmarkPivotingRegistration");
 
   ToolStatus status(TOOL_INVALID);
   vtkSmartPointer<vtkMatrix4x4> stylusTipToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(m_PhantomLandmarkRegistration->GetStylusTipCoordinateFrame(), m_PhantomLandmarkRegistration->GetReferenceCoordinateFrame(), stylusTipToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
+  igsioTransformName stylusTipToReferenceTransformName(m_PhantomLandmarkRegistration->GetStylusTipCoordinateFrame(), m_PhantomLandmarkRegistration->GetReferenceCoordinateFrame());
+  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(aTrackedFrameSnapshot, stylusTipToReferenceTransformName, stylusTipToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
   {
     LOG_ERROR("No transform found between stylus tip and reference!");
     return;
@@ -1284,13 +1330,28 @@ void QPhantomRegistrationToolbox::AddStylusTipTransformToLandmarkPivotingRegistr
 
 //-----------------------------------------------------------------------------
 void QPhantomRegistrationToolbox::AddStylusTipTransformToLinearObjectRegistration()
+{
+  LOG_TRACE("PhantomRegistrationToolbox::AddStylusTipTransformToLinearObjectRegistration");
+
+  // Process all positions acquired since the previous tick, so that the collection keeps up with the tracker rate
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> > snapshots;
+  GetNewTrackedFrameSnapshots(snapshots);
+  for (std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >::iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+  {
+    AddStylusTipPositionToLinearObjectRegistration(*it);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void QPhantomRegistrationToolbox::AddStylusTipPositionToLinearObjectRegistration(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot)
 {
   LOG_TRACE("PhantomRegistrationToolbox::AddStylusTipPositionToLinearObjectRegistration");
 
   // Get stylus tip position
   vtkSmartPointer<vtkMatrix4x4> stylusTipToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   ToolStatus status(TOOL_INVALID);
-  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(m_PhantomLinearObjectRegistration->GetStylusTipCoordinateFrame(), m_PhantomLinearObjectRegistration->GetReferenceCoordinateFrame(), stylusTipToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
+  igsioTransformName stylusTipToReferenceTransformName(m_PhantomLinearObjectRegistration->GetStylusTipCoordinateFrame(), m_PhantomLinearObjectRegistration->GetReferenceCoordinateFrame());
+  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(aTrackedFrameSnapshot, stylusTipToReferenceTransformName, stylusTipToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
   {
     LOG_ERROR("No transform found between stylus tip and reference!");
     return;
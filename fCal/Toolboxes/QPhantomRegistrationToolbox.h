@@ -17,6 +17,7 @@ See License.txt for details.
 class vtkPlusPhantomLandmarkRegistrationAlgo;
 class vtkPlusPhantomLinearObjectRegistrationAlgo;
 class vtkPlusLandmarkDetectionAlgo;
+class vtkPlusTrackedFrameSnapshot;
 class vtkActor;
 class vtkPolyData;
 class vtkRenderer;
@@ -189,6 +190,25 @@ protected slots:
   */
   void AddStylusTipTransformToLandmarkPivotingRegistration();
 
+protected:
+  /*!
+  * Collect the snapshots acquired since the previous acquisition tick that have not been processed yet
+  * \param aSnapshots Out parameter for the snapshots, in acquisition order
+  */
+  void GetNewTrackedFrameSnapshots(std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& aSnapshots);
+
+  /*!
+  * Add the stylus tip position of a tracked frame snapshot to the linear object registration if it fulfills the criteria
+  * \param aTrackedFrameSnapshot Snapshot to get the stylus tip position from
+  */
+  void AddStylusTipPositionToLinearObjectRegistration(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot);
+
+  /*!
+  * Update the landmark detection with the stylus tip position of a tracked frame snapshot
+  * \param aTrackedFrameSnapshot Snapshot to get the stylus tip position from
+  */
+  void AddStylusTipPositionToLandmarkPivotingRegistration(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot);
+
 protected:
   /*! Phantom landmark registration algorithm */
   vtkSmartPointer<vtkPlusPhantomLandmarkRegistrationAlgo>     m_PhantomLandmarkRegistration;
@@ -236,6 +256,9 @@ protected:
   /*! Previous stylus tip to reference transform matrix to determine the difference at each point acquisition */
   vtkSmartPointer<vtkMatrix4x4>           m_PreviousStylusTipToReferenceTransformMatrix;
 
+  /*! Timestamp of the last processed snapshot, snapshots that are not newer are skipped */
+  double                                  m_LastProcessedSnapshotTimestamp;
+
 protected:
   Ui::PhantomRegistrationToolbox ui;
 
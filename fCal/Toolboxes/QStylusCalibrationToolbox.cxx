@@ -20,6 +20,9 @@ See License.txt for details.
 #include <vtkPoints.h>
 #include <vtkRenderer.h>
 
+// STL includes
+#include <limits>
+
 //-----------------------------------------------------------------------------
 QStylusCalibrationToolbox::QStylusCalibrationToolbox(fCalMainWindow* aParentMainWindow, Qt::WindowFlags aFlags)
   : QAbstractToolbox(aParentMainWindow)
@@ -29,6 +32,7 @@ QStylusCalibrationToolbox::QStylusCalibrationToolbox(fCalMainWindow* aParentMain
   , m_FreeHandStartupDelaySec(5)
   , m_CurrentPointNumber(0)
   , m_PreviousStylusToReferenceTransformMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  , m_LastProcessedSnapshotTimestamp(-std::numeric_limits<double>::max())
 {
   ui.setupUi(this);
 
@@ -415,6 +419,7 @@ void QStylusCalibrationToolbox::StartCalibration()
   LOG_TRACE("StylusCalibrationToolbox::Start");
 
   m_CurrentPointNumber = 0;
+  m_LastProcessedSnapshotTimestamp = -std::numeric_limits<double>::max();
 
   // Clear input points and result point
   m_ParentMainWindow->GetVisualizationController()->SetInputColor(0.0, 0.7, 1.0);
@@ -532,12 +537,37 @@ void QStylusCalibrationToolbox::OnDataAcquired()
     return;
   }
 
+  // Process all positions acquired since the previous tick, so that the collection keeps up with the tracker rate
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> > snapshots = m_ParentMainWindow->GetVisualizationController()->GetAcquiredTrackedFrameSnapshots();
+  if (snapshots.empty())
+  {
+    snapshots.push_back(m_ParentMainWindow->GetVisualizationController()->GetTrackedFrameSnapshot());
+  }
+
+  for (std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >::iterator it = snapshots.begin(); it != snapshots.end() && m_State == ToolboxState_InProgress; ++it)
+  {
+    // The snapshots of a tick may be offered again if this slot is called before the controller is updated
+    if ((*it)->IsValid())
+    {
+      if ((*it)->GetTimestamp() <= m_LastProcessedSnapshotTimestamp)
+      {
+        continue;
+      }
+      m_LastProcessedSnapshotTimestamp = (*it)->GetTimestamp();
+    }
+
+    AddStylusPosition(*it);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void QStylusCalibrationToolbox::AddStylusPosition(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot)
+{
   // Get stylus position
   vtkSmartPointer<vtkMatrix4x4> stylusToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   ToolStatus status(TOOL_INVALID);
-  std::string objectMarkerCoordinateFrame = m_PivotCalibration->GetObjectMarkerCoordinateFrame();
-  std::string referenceCoordinateFrame = m_PivotCalibration->GetReferenceCoordinateFrame();
-  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(objectMarkerCoordinateFrame.c_str(), referenceCoordinateFrame.c_str(), stylusToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
+  igsioTransformName stylusToReferenceTransformName(m_PivotCalibration->GetObjectMarkerCoordinateFrame(), m_PivotCalibration->GetReferenceCoordinateFrame());
+  if (m_ParentMainWindow->GetVisualizationController()->GetTransformMatrix(aTrackedFrameSnapshot, stylusToReferenceTransformName, stylusToReferenceTransformMatrix, &status) != PLUS_SUCCESS)
   {
     LOG_ERROR("No transform found between stylus and reference!");
     return;
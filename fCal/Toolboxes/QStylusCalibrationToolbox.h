@@ -16,6 +16,7 @@ See License.txt for details.
 #include <QTime>
 
 class vtkPlusPivotCalibrationAlgo;
+class vtkPlusTrackedFrameSnapshot;
 class vtkMatrix4x4;
 
 //-----------------------------------------------------------------------------
@@ -81,13 +82,20 @@ protected slots:
   void NumberOfStylusCalibrationPointsChanged(int aNumberOfPoints);
 
   /*!
-  * Acquire stylus position and add it to the algorithm (called by the acquisition timer in object visualizer)
+  * Add the stylus positions that were acquired since the previous acquisition tick to the algorithm (called by the acquisition timer in object visualizer)
   */
   void OnDataAcquired();
 
 protected:
   /*! Start calibration */
   void StartCalibration();
+
+  /*!
+  * Add the stylus position of a tracked frame snapshot to the algorithm if it fulfills the criteria
+  * \param aTrackedFrameSnapshot Snapshot to get the stylus position from
+  */
+  void AddStylusPosition(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot);
+
   void SetFreeHandStartupDelaySec(int freeHandStartupDelaySec);
 
   vtkSmartPointer<vtkPlusPivotCalibrationAlgo>  m_PivotCalibration;
@@ -96,6 +104,8 @@ protected:
   int                                           m_CurrentPointNumber;
   QString                                       m_StylusPositionString;
   vtkSmartPointer<vtkMatrix4x4>                 m_PreviousStylusToReferenceTransformMatrix;
+  /*! Timestamp of the last processed snapshot, snapshots that are not newer are skipped */
+  double                                        m_LastProcessedSnapshotTimestamp;
   QTime                                         m_CalibrationStartupDelayStartTime;
 
 protected:
@@ -66,6 +66,10 @@ fCalMainWindow::~fCalMainWindow()
 {
   if (m_VisualizationController != NULL)
   {
+    // The toolbox widgets are destroyed only after this destructor, stop their work (e.g., the recording thread
+    // of the capturing toolbox) while the data collector they use is still available
+    ResetAllToolboxes();
+
     m_VisualizationController->Delete();
     m_VisualizationController = NULL;
   }
@@ -414,7 +418,11 @@ void fCalMainWindow::UpdateGUI()
     }
   }
 
-  ui.canvas->update();
+  // Repaint the canvas only if the visualization controller rendered since the last refresh
+  if (m_VisualizationController->ConsumeCanvasUpdateRequest())
+  {
+    ui.canvas->update();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -86,7 +86,7 @@ vtkPlus3DObjectVisualizer::~vtkPlus3DObjectVisualizer()
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlus3DObjectVisualizer::Update()
+PlusStatus vtkPlus3DObjectVisualizer::Update(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot)
 {
   // If none of the objects are displayable then return with fail
   bool noObjectsToDisplay = true;
@@ -105,9 +105,8 @@ PlusStatus vtkPlus3DObjectVisualizer::Update()
     return PLUS_SUCCESS;
   }
 
-  // Get tracked frame and set the transforms
-  igsioTrackedFrame trackedFrame;
-  if (this->SelectedChannel->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
+  // Set the transforms of the tracked frame snapshot
+  if (aTrackedFrameSnapshot == NULL || !aTrackedFrameSnapshot->IsValid())
   {
     LOG_ERROR("Failed to get tracked frame!");
     return PLUS_FAIL;
@@ -117,7 +116,7 @@ PlusStatus vtkPlus3DObjectVisualizer::Update()
   {
     return PLUS_FAIL;
   }
-  if (this->TransformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+  if (aTrackedFrameSnapshot->SetTransformsToRepository(this->TransformRepository) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to set current transforms to transform repository!");
     return PLUS_FAIL;
@@ -9,6 +9,7 @@
 
 // Local includes
 #include "vtkPlusDisplayableObject.h"
+#include "vtkPlusTrackedFrameSnapshot.h"
 
 // PlusLib includes
 #include <PlusConfigure.h>
@@ -119,8 +120,9 @@ public:
 
   /*!
   * Update the displayable objects
+  * \param aTrackedFrameSnapshot Snapshot of the current acquisition tick that contains the tool transforms
   */
-  PlusStatus Update();
+  PlusStatus Update(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot);
 
   // Set/Get for member variables
   vtkRenderer* GetCanvasRenderer() const;
@@ -0,0 +1,160 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "vtkPlusAcquisitionThread.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <chrono>
+
+//-----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusAcquisitionThread);
+
+//-----------------------------------------------------------------------------
+vtkPlusAcquisitionThread::vtkPlusAcquisitionThread()
+  : QueueHead(0)
+  , QueueTail(0)
+  , NumberOfDroppedSnapshots(0)
+  , StopRequested(false)
+  , Channel(NULL)
+  , PollingPeriodSec(0.005)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusAcquisitionThread::~vtkPlusAcquisitionThread()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusAcquisitionThread::Start(vtkPlusChannel* aChannel)
+{
+  this->Stop();
+
+  if (aChannel == NULL)
+  {
+    LOG_ERROR("Unable to start acquisition thread without a channel!");
+    return PLUS_FAIL;
+  }
+
+  this->Channel = aChannel;
+  this->QueueHead = 0;
+  this->QueueTail = 0;
+  this->NumberOfDroppedSnapshots = 0;
+  this->StopRequested = false;
+  this->Thread = std::thread(&vtkPlusAcquisitionThread::AcquisitionLoop, this);
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusAcquisitionThread::Stop()
+{
+  if (!this->Thread.joinable())
+  {
+    return;
+  }
+
+  this->StopRequested = true;
+  this->Thread.join();
+  this->Channel = NULL;
+
+  // Release the snapshots that were not popped
+  for (unsigned int i = 0; i < QUEUE_SIZE; ++i)
+  {
+    this->Queue[i] = NULL;
+  }
+  this->QueueHead = 0;
+  this->QueueTail = 0;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusAcquisitionThread::IsRunning() const
+{
+  return this->Thread.joinable();
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlusAcquisitionThread::PopSnapshots(std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& aSnapshots)
+{
+  unsigned int head = this->QueueHead.load(std::memory_order_relaxed);
+  unsigned int tail = this->QueueTail.load(std::memory_order_acquire);
+
+  int numberOfPoppedSnapshots(0);
+  for (; head != tail; ++head, ++numberOfPoppedSnapshots)
+  {
+    vtkSmartPointer<vtkPlusTrackedFrameSnapshot>& slot = this->Queue[head % QUEUE_SIZE];
+    aSnapshots.push_back(slot);
+    slot = NULL;
+  }
+
+  // Hand the slots back to the worker thread
+  this->QueueHead.store(head, std::memory_order_release);
+
+  return numberOfPoppedSnapshots;
+}
+
+//-----------------------------------------------------------------------------
+unsigned int vtkPlusAcquisitionThread::GetNumberOfDroppedSnapshots() const
+{
+  return this->NumberOfDroppedSnapshots;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusAcquisitionThread::PushSnapshot(vtkPlusTrackedFrameSnapshot* aSnapshot)
+{
+  unsigned int tail = this->QueueTail.load(std::memory_order_relaxed);
+  unsigned int head = this->QueueHead.load(std::memory_order_acquire);
+  if (tail - head >= QUEUE_SIZE)
+  {
+    return false;
+  }
+
+  this->Queue[tail % QUEUE_SIZE] = aSnapshot;
+
+  // Publish the slot to the popping thread
+  this->QueueTail.store(tail + 1, std::memory_order_release);
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusAcquisitionThread::AcquisitionLoop()
+{
+  bool frameAcquired(false);
+  double lastAcquiredTimestamp(0.0);
+  const std::chrono::microseconds pollingPeriod(static_cast<long long>(this->PollingPeriodSec * 1000000.0));
+
+  while (!this->StopRequested)
+  {
+    // Checking the timestamp is cheap, the transforms are only copied if a new frame arrived
+    double latestTimestamp(0.0);
+    if (this->Channel->GetMostRecentTimestamp(latestTimestamp) != PLUS_SUCCESS || (frameAcquired && latestTimestamp <= lastAcquiredTimestamp))
+    {
+      std::this_thread::sleep_for(pollingPeriod);
+      continue;
+    }
+
+    vtkSmartPointer<vtkPlusTrackedFrameSnapshot> snapshot = vtkSmartPointer<vtkPlusTrackedFrameSnapshot>::New();
+    if (snapshot->Acquire(this->Channel) != PLUS_SUCCESS)
+    {
+      std::this_thread::sleep_for(pollingPeriod);
+      continue;
+    }
+    frameAcquired = true;
+    lastAcquiredTimestamp = snapshot->GetTimestamp();
+
+    if (!this->PushSnapshot(snapshot))
+    {
+      ++this->NumberOfDroppedSnapshots;
+    }
+  }
+}
@@ -0,0 +1,112 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusAcquisitionThread_h
+#define __vtkPlusAcquisitionThread_h
+
+// Local includes
+#include "vtkPlusTrackedFrameSnapshot.h"
+
+// PlusLib includes
+#include <PlusConfigure.h>
+#include <vtkPlusChannel.h>
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+
+/*! \class vtkPlusAcquisitionThread
+ * \brief Worker thread that acquires tracked frame snapshots of a channel independently from the GUI thread
+ *
+ * The thread polls the channel and acquires a vtkPlusTrackedFrameSnapshot each time a new frame arrives.
+ * The snapshots are passed to the GUI thread through a lock-free single-producer single-consumer queue,
+ * so data collection keeps up with the device rate even if rendering or user interaction blocks the GUI thread.
+ * If the GUI thread does not pop the snapshots in time, then the newest snapshots are dropped until there is room in the queue.
+ * \ingroup PlusAppCommonWidgets
+ */
+class vtkPlusAcquisitionThread : public vtkObject
+{
+public:
+  vtkTypeMacro(vtkPlusAcquisitionThread, vtkObject);
+  static vtkPlusAcquisitionThread* New();
+
+  /*!
+  * Start acquiring snapshots from a channel. A running acquisition is stopped first.
+  * \param aChannel Channel to acquire the snapshots from. It must not be deleted before Stop() is called.
+  */
+  PlusStatus Start(vtkPlusChannel* aChannel);
+
+  /*! Stop the acquisition and wait for the thread to finish. Snapshots that are still in the queue are discarded. */
+  void Stop();
+
+  /*! Return true if the acquisition thread is running */
+  bool IsRunning() const;
+
+  /*!
+  * Move all queued snapshots to the end of a list, in acquisition order. Only one thread may pop snapshots.
+  * \param aSnapshots List to append the snapshots to
+  * \return Number of snapshots that were appended
+  */
+  int PopSnapshots(std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& aSnapshots);
+
+  /*! Get the number of snapshots that were dropped because the queue was full since Start() */
+  unsigned int GetNumberOfDroppedSnapshots() const;
+
+  /*! Set the time the thread waits between polls of the channel if no new frame is available */
+  vtkSetMacro(PollingPeriodSec, double);
+  vtkGetMacro(PollingPeriodSec, double);
+
+protected:
+  vtkPlusAcquisitionThread();
+  virtual ~vtkPlusAcquisitionThread();
+
+  /*! Acquisition loop that runs on the worker thread */
+  void AcquisitionLoop();
+
+  /*! Add a snapshot to the queue, called only on the worker thread. Return false if the queue is full. */
+  bool PushSnapshot(vtkPlusTrackedFrameSnapshot* aSnapshot);
+
+protected:
+  /*! Number of snapshots the queue can hold. About one second of data for typical tracker rates. */
+  static const unsigned int QUEUE_SIZE = 128;
+
+  /*! Ring buffer of the queue. A slot is written only by the worker thread and cleared only by the popping thread. */
+  vtkSmartPointer<vtkPlusTrackedFrameSnapshot> Queue[QUEUE_SIZE];
+
+  /*! Number of snapshots popped since Start(), written only by the popping thread */
+  std::atomic<unsigned int> QueueHead;
+
+  /*! Number of snapshots pushed since Start(), written only by the worker thread */
+  std::atomic<unsigned int> QueueTail;
+
+  /*! Number of snapshots dropped because the queue was full */
+  std::atomic<unsigned int> NumberOfDroppedSnapshots;
+
+  /*! Flag signaling the worker thread to finish */
+  std::atomic<bool> StopRequested;
+
+  /*! Worker thread */
+  std::thread Thread;
+
+  /*! Channel to acquire the snapshots from */
+  vtkPlusChannel* Channel;
+
+  /*! Time to wait between polls of the channel if no new frame is available */
+  double PollingPeriodSec;
+
+private:
+  vtkPlusAcquisitionThread(const vtkPlusAcquisitionThread&);
+  void operator=(const vtkPlusAcquisitionThread&);
+};
+
+#endif  //__vtkPlusAcquisitionThread_h
@@ -58,6 +58,9 @@ vtkPlusImageVisualizer::vtkPlusImageVisualizer()
   , RightLineSource(vtkSmartPointer<vtkLineSource>::New())
   , BottomLineSource(vtkSmartPointer<vtkLineSource>::New())
   , SelectedChannel(NULL)
+  , ImageStreaming(true)
+  , LastStreamedVideoItemUidValid(false)
+  , LastStreamedVideoItemUid(0)
   , LineSegmentationLineSource(vtkSmartPointer<vtkLineSource>::New())
   , LineSegmentationActor(vtkSmartPointer<vtkActor>::New())
 {
@@ -485,6 +488,35 @@ void vtkPlusImageVisualizer::SetInputData(vtkImageData* aImage)
   this->GetImageActor()->SetInputData(aImage);
 }
 
+//-----------------------------------------------------------------------------
+vtkImageData* vtkPlusImageVisualizer::UpdateStreamedImage()
+{
+  if (this->SelectedChannel == NULL || !this->SelectedChannel->GetVideoDataAvailable())
+  {
+    return NULL;
+  }
+
+  // Skip the copy and the texture upload if the latest frame is already displayed
+  vtkPlusDataSource* videoSource(NULL);
+  if (this->ImageStreaming && this->SelectedChannel->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
+  {
+    if (videoSource->GetNumberOfItems() == 0)
+    {
+      return NULL;
+    }
+    BufferItemUidType latestVideoItemUid = videoSource->GetLatestItemUidInBuffer();
+    if (this->LastStreamedVideoItemUidValid && latestVideoItemUid == this->LastStreamedVideoItemUid)
+    {
+      return NULL;
+    }
+    this->LastStreamedVideoItemUid = latestVideoItemUid;
+    this->LastStreamedVideoItemUidValid = true;
+  }
+
+  // Copies the latest frame into the persistent brightness image of the channel
+  return this->SelectedChannel->GetBrightnessOutput();
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusImageVisualizer::SetResultPolyData(vtkPolyData* aResultPolyData)
 {
@@ -978,6 +1010,7 @@ PlusStatus vtkPlusImageVisualizer::ClearWireLabelVisualization()
 void vtkPlusImageVisualizer::SetChannel(vtkPlusChannel* channel)
 {
   SetSelectedChannel(channel);
+  this->LastStreamedVideoItemUidValid = false;
 
   if (this->SelectedChannel != NULL && this->SelectedChannel->GetBrightnessOutput() != NULL)
   {
@@ -11,6 +11,7 @@ See License.txt for details.
 #include <PlusConfigure.h>
 #include <igsioVideoFrame.h>
 #include <vtkPlusChannel.h>
+#include <vtkPlusDataSource.h>
 
 // VTK includes
 #include <vtkActor.h>
@@ -68,6 +69,19 @@ public:
   */
   void SetInputData(vtkImageData* aImage);
 
+  /*! Update the brightness image of the selected channel from its latest video frame.
+  * The brightness image is the same object for every frame, so the image actors keep their input and the image mapper
+  * can update its existing texture in place instead of creating a new one. In image streaming mode the frame is only copied
+  * (and the texture only re-uploaded) if a new frame arrived in the video buffer since the previous call.
+  * \return The updated brightness image, or NULL if there was no new frame to copy
+  */
+  vtkImageData* UpdateStreamedImage();
+
+  /*! Enable/disable image streaming mode. If disabled then UpdateStreamedImage() copies the latest frame on every call. */
+  vtkSetMacro(ImageStreaming, bool);
+  vtkGetMacro(ImageStreaming, bool);
+  vtkBooleanMacro(ImageStreaming, bool);
+
   /* Set the slice number of the data */
   PlusStatus SetSliceNumber(int number);
 
@@ -217,6 +231,12 @@ protected:
   double                                                RegionOfInterest[4];
   ///  The channel to visualize
   vtkPlusChannel*                                       SelectedChannel;
+  ///  Flag indicating if the brightness image is only updated when a new video frame arrives
+  bool                                                  ImageStreaming;
+  ///  Flag indicating if LastStreamedVideoItemUid is valid for the selected channel
+  bool                                                  LastStreamedVideoItemUidValid;
+  ///  Buffer item UID of the video frame that was copied into the brightness image last
+  BufferItemUidType                                     LastStreamedVideoItemUid;
   ///  Vector to hold the actors for each wire
   std::vector<vtkSmartPointer<vtkTextActor3D>>          WireActors;
   /// Line visualization members
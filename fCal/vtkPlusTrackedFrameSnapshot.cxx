@@ -0,0 +1,104 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "vtkPlusTrackedFrameSnapshot.h"
+
+// PlusLib includes
+#include <igsioTrackedFrame.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//-----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusTrackedFrameSnapshot);
+
+//-----------------------------------------------------------------------------
+vtkPlusTrackedFrameSnapshot::vtkPlusTrackedFrameSnapshot()
+  : Timestamp(0.0)
+  , Valid(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkPlusTrackedFrameSnapshot::~vtkPlusTrackedFrameSnapshot()
+{
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackedFrameSnapshot::Acquire(vtkPlusChannel* aChannel)
+{
+  this->Transforms.clear();
+  this->Valid = false;
+
+  if (aChannel == NULL)
+  {
+    return PLUS_FAIL;
+  }
+
+  // Only the transforms are needed, so the image of the latest frame is not copied
+  double latestTimestamp(0.0);
+  igsioTrackedFrame trackedFrame;
+  if (aChannel->GetMostRecentTimestamp(latestTimestamp) != PLUS_SUCCESS
+      || aChannel->GetTrackedFrame(latestTimestamp, trackedFrame, false) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  std::vector<igsioTransformName> transformNames;
+  trackedFrame.GetFrameTransformNameList(transformNames);
+  for (std::vector<igsioTransformName>::iterator it = transformNames.begin(); it != transformNames.end(); ++it)
+  {
+    FrameTransform frameTransform;
+    frameTransform.Name = *it;
+    frameTransform.Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    frameTransform.Status = TOOL_INVALID;
+    if (trackedFrame.GetFrameTransform(frameTransform.Name, frameTransform.Matrix) != IGSIO_SUCCESS)
+    {
+      LOG_WARNING("Failed to get frame transform " << frameTransform.Name.GetTransformName() << " from tracked frame");
+      continue;
+    }
+    trackedFrame.GetFrameTransformStatus(frameTransform.Name, frameTransform.Status);
+    this->Transforms.push_back(frameTransform);
+  }
+
+  this->Timestamp = latestTimestamp;
+  this->Valid = true;
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackedFrameSnapshot::SetTransformsToRepository(vtkIGSIOTransformRepository* aTransformRepository) const
+{
+  if (aTransformRepository == NULL || !this->Valid)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<FrameTransform>::const_iterator it = this->Transforms.begin(); it != this->Transforms.end(); ++it)
+  {
+    if (aTransformRepository->SetTransform(it->Name, it->Matrix, it->Status) != IGSIO_SUCCESS)
+    {
+      LOG_ERROR("Failed to set transform " << it->Name.GetTransformName() << " to transform repository");
+      status = PLUS_FAIL;
+    }
+  }
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusTrackedFrameSnapshot::IsValid() const
+{
+  return this->Valid;
+}
+
+//-----------------------------------------------------------------------------
+double vtkPlusTrackedFrameSnapshot::GetTimestamp() const
+{
+  return this->Timestamp;
+}
@@ -0,0 +1,77 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusTrackedFrameSnapshot_h
+#define __vtkPlusTrackedFrameSnapshot_h
+
+// PlusLib includes
+#include <PlusConfigure.h>
+#include <vtkIGSIOTransformRepository.h>
+#include <vtkPlusChannel.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+//-----------------------------------------------------------------------------
+
+/*! \class vtkPlusTrackedFrameSnapshot
+ * \brief Tool transforms of the latest tracked frame of a channel, taken at one instant
+ *
+ * The snapshot is filled once by Acquire() and is not modified afterwards, so the same reference-counted
+ * snapshot can be shared by all components that are updated in an acquisition tick. The channel buffers are
+ * then read only once per tick and all views show the same instant. Image data is not copied.
+ * \ingroup PlusAppCommonWidgets
+ */
+class vtkPlusTrackedFrameSnapshot : public vtkObject
+{
+public:
+  vtkTypeMacro(vtkPlusTrackedFrameSnapshot, vtkObject);
+  static vtkPlusTrackedFrameSnapshot* New();
+
+  /*!
+  * Read the tool transforms of the latest tracked frame of a channel. Call it only once, before the snapshot is shared.
+  * \param aChannel Channel to read the tracked frame from
+  */
+  PlusStatus Acquire(vtkPlusChannel* aChannel);
+
+  /*!
+  * Set all tool transforms of the snapshot to a transform repository
+  * \param aTransformRepository Transform repository to update
+  */
+  PlusStatus SetTransformsToRepository(vtkIGSIOTransformRepository* aTransformRepository) const;
+
+  /*! Return true if the tracked frame has been acquired successfully */
+  bool IsValid() const;
+
+  /*! Return the timestamp of the acquired tracked frame */
+  double GetTimestamp() const;
+
+protected:
+  vtkPlusTrackedFrameSnapshot();
+  virtual ~vtkPlusTrackedFrameSnapshot();
+
+protected:
+  /*! Tool transform of the tracked frame with its status */
+  struct FrameTransform
+  {
+    igsioTransformName Name;
+    vtkSmartPointer<vtkMatrix4x4> Matrix;
+    ToolStatus Status;
+  };
+
+  /*! Tool transforms of the tracked frame */
+  std::vector<FrameTransform> Transforms;
+
+  /*! Timestamp of the tracked frame */
+  double Timestamp;
+
+  /*! Flag indicating if the tracked frame has been acquired successfully */
+  bool Valid;
+};
+
+#endif  //__vtkPlusTrackedFrameSnapshot_h
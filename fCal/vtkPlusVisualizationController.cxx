@@ -11,6 +11,7 @@ See License.txt for details.
 
 // PlusLib includes
 #include <igsioTrackedFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
 #include <vtkPlusDevice.h>
 #include <vtkIGSIOTrackedFrameList.h>
 
@@ -18,8 +19,11 @@ See License.txt for details.
 #include <QVTKOpenGLNativeWidget.h>
 #include <vtkDirectory.h>
 #include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkCamera.h>
+#include <vtkImageData.h>
 #include <vtkMath.h>
 #include <vtkPolyData.h>
+#include <vtkPropCollection.h>
 #include <vtkProperty.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -32,6 +36,9 @@ See License.txt for details.
 #include <QEvent>
 #include <QTimer>
 
+// STL includes
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusVisualizationController);
@@ -55,9 +62,17 @@ vtkPlusVisualizationController::vtkPlusVisualizationController()
   , InputPolyData(vtkSmartPointer<vtkPolyData>::New())
   , CurrentMode(DISPLAY_MODE_NONE)
   , AcquisitionFrameRate(20)
+  , MaximumRenderFrameRate(30.0)
+  , LastRenderTimeSec(0.0)
+  , LastRenderedRenderer(NULL)
+  , LastRenderedSceneModifiedTime(0)
+  , LastUpdatedTrackedFrameTimestamp(0.0)
+  , CanvasUpdateRequested(false)
   , TransformRepository(NULL)
   , SelectedChannel(NULL)
   , DataCollector(NULL)
+  , AcquisitionThread(vtkSmartPointer<vtkPlusAcquisitionThread>::New())
+  , NumberOfReportedDroppedSnapshots(0)
 {
   // Create transform repository
   this->ClearTransformRepository();
@@ -94,6 +109,9 @@ vtkPlusVisualizationController::~vtkPlusVisualizationController()
   disconnect(&this->AcquisitionTimer, &QTimer::timeout, this, &vtkPlusVisualizationController::Update);
   this->AcquisitionTimer.stop();
 
+  // The acquisition thread uses the channel of the data collector
+  this->AcquisitionThread->Stop();
+
   if (this->GetDataCollector() != NULL)
   {
     this->GetDataCollector()->Stop();
@@ -364,6 +382,7 @@ PlusStatus vtkPlusVisualizationController::StartDataCollection()
   vtkPlusDataCollector* dataCollector = this->GetDataCollector();
   if (dataCollector != NULL)
   {
+    this->AcquisitionThread->Stop();
     dataCollector->Stop();
     dataCollector->Disconnect();
     this->SetDataCollector(NULL);
@@ -447,26 +466,118 @@ PlusStatus vtkPlusVisualizationController::SetScreenRightDownAxesOrientation(US_
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVisualizationController::Update()
 {
-  if (this->PerspectiveVisualizer != NULL && CurrentMode == DISPLAY_MODE_3D)
+  // Collect the snapshots that were acquired since the previous tick
+  this->AcquiredTrackedFrameSnapshots.clear();
+  this->AcquisitionThread->PopSnapshots(this->AcquiredTrackedFrameSnapshots);
+
+  // Snapshots are dropped by the acquisition thread if they are not collected in time, e.g., while the GUI thread is busy
+  const unsigned int numberOfDroppedSnapshots = this->AcquisitionThread->GetNumberOfDroppedSnapshots();
+  if (numberOfDroppedSnapshots < this->NumberOfReportedDroppedSnapshots)
+  {
+    // The acquisition thread has been restarted
+    this->NumberOfReportedDroppedSnapshots = 0;
+  }
+  if (numberOfDroppedSnapshots > this->NumberOfReportedDroppedSnapshots)
   {
-    this->PerspectiveVisualizer->Update();
+    LOG_WARNING(numberOfDroppedSnapshots - this->NumberOfReportedDroppedSnapshots << " tracked frame snapshots were dropped because they were not processed in time ("
+                << numberOfDroppedSnapshots << " since the acquisition started)");
+    this->NumberOfReportedDroppedSnapshots = numberOfDroppedSnapshots;
   }
 
-  // Force update of the brightness image in the DataCollector,
+  if (!this->AcquiredTrackedFrameSnapshots.empty())
+  {
+    this->TrackedFrameSnapshot = this->AcquiredTrackedFrameSnapshots.back();
+  }
+  else if (!this->AcquisitionThread->IsRunning())
+  {
+    // New acquisition tick, the snapshot is acquired again on the next request
+    this->TrackedFrameSnapshot = NULL;
+  }
+
+  // Update the brightness image in the DataCollector if a new video frame arrived,
   // because it is the image that the image actors show
-  if (this->SelectedChannel != NULL && this->GetImageActor() != NULL)
+  if (this->SelectedChannel != NULL && this->GetImageActor() != NULL && this->ImageVisualizer != NULL)
   {
-    this->GetImageActor()->SetInputData(this->SelectedChannel->GetBrightnessOutput());
+    vtkImageData* brightnessImage = this->ImageVisualizer->UpdateStreamedImage();
+    if (brightnessImage != NULL && this->GetImageActor()->GetInput() != brightnessImage)
+    {
+      this->GetImageActor()->SetInputData(brightnessImage);
+    }
+  }
+
+  vtkRenderer* renderer = this->GetCanvasRenderer();
+  if (renderer == nullptr || renderer->GetRenderWindow() == nullptr)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  bool sceneModified = (renderer != this->LastRenderedRenderer) || (this->GetSceneModifiedTime(renderer) > this->LastRenderedSceneModifiedTime);
+
+  // The object poses only change if a new tracked frame arrived
+  if (this->PerspectiveVisualizer != NULL && CurrentMode == DISPLAY_MODE_3D)
+  {
+    vtkPlusTrackedFrameSnapshot* trackedFrameSnapshot = this->GetTrackedFrameSnapshot();
+    if (sceneModified || trackedFrameSnapshot->GetTimestamp() != this->LastUpdatedTrackedFrameTimestamp)
+    {
+      this->PerspectiveVisualizer->Update(trackedFrameSnapshot);
+      this->LastUpdatedTrackedFrameTimestamp = trackedFrameSnapshot->GetTimestamp();
+      sceneModified = true;
+    }
+  }
+
+  if (!sceneModified)
+  {
+    return PLUS_SUCCESS;
   }
 
-  if (this->GetCanvasRenderer() != nullptr && this->GetCanvasRenderer()->GetRenderWindow() != nullptr)
+  // Limit the render rate, the modifications are rendered on a later tick
+  double currentTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (this->MaximumRenderFrameRate > 0 && currentTimeSec - this->LastRenderTimeSec < 1.0 / this->MaximumRenderFrameRate)
   {
-    this->GetCanvasRenderer()->GetRenderWindow()->Render();
+    return PLUS_SUCCESS;
   }
 
+  renderer->GetRenderWindow()->Render();
+
+  // Rendering may modify the camera (e.g., clipping range), so the modification time is taken afterwards
+  this->LastRenderTimeSec = currentTimeSec;
+  this->LastRenderedRenderer = renderer;
+  this->LastRenderedSceneModifiedTime = this->GetSceneModifiedTime(renderer);
+  this->CanvasUpdateRequested = true;
+
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkPlusVisualizationController::GetSceneModifiedTime(vtkRenderer* aRenderer)
+{
+  vtkMTimeType modifiedTime = std::max(aRenderer->GetMTime(), aRenderer->GetActiveCamera()->GetMTime());
+
+  // The redraw time of the actors includes their mappers and input data
+  vtkPropCollection* props = aRenderer->GetViewProps();
+  vtkCollectionSimpleIterator propIt;
+  props->InitTraversal(propIt);
+  for (vtkProp* prop = props->GetNextProp(propIt); prop != NULL; prop = props->GetNextProp(propIt))
+  {
+    modifiedTime = std::max(modifiedTime, prop->GetRedrawMTime());
+  }
+
+  if (this->GetImageActor() != NULL && this->GetImageActor()->GetInput() != NULL)
+  {
+    modifiedTime = std::max(modifiedTime, this->GetImageActor()->GetInput()->GetMTime());
+  }
+
+  return modifiedTime;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusVisualizationController::ConsumeCanvasUpdateRequest()
+{
+  bool canvasUpdateRequested = this->CanvasUpdateRequested;
+  this->CanvasUpdateRequested = false;
+  return canvasUpdateRequested;
+}
+
 //-----------------------------------------------------------------------------
 vtkRenderer* vtkPlusVisualizationController::GetCanvasRenderer()
 {
@@ -540,15 +651,14 @@ PlusStatus vtkPlusVisualizationController::GetTransformMatrix(const char* aTrans
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVisualizationController::GetTransformMatrix(igsioTransformName aTransform, vtkMatrix4x4* aOutputMatrix, ToolStatus* aStatus/* = NULL*/)
 {
-  igsioTrackedFrame trackedFrame;
-  if (this->SelectedChannel == NULL || this->SelectedChannel->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Unable to get tracked frame from selected channel!");
-    return PLUS_FAIL;
-  }
-  if (this->TransformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+  return GetTransformMatrix(this->GetTrackedFrameSnapshot(), aTransform, aOutputMatrix, aStatus);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVisualizationController::GetTransformMatrix(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot, igsioTransformName aTransform, vtkMatrix4x4* aOutputMatrix, ToolStatus* aStatus/* = NULL*/)
+{
+  if (this->SetTransformsToRepository(aTrackedFrameSnapshot) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Unable to set transforms from tracked frame!");
     return PLUS_FAIL;
   }
 
@@ -563,6 +673,50 @@ PlusStatus vtkPlusVisualizationController::GetTransformMatrix(igsioTransformName
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+vtkPlusTrackedFrameSnapshot* vtkPlusVisualizationController::GetTrackedFrameSnapshot()
+{
+  if (this->TrackedFrameSnapshot == NULL)
+  {
+    // A failed acquisition is not retried in the same tick, consumers check IsValid()
+    this->TrackedFrameSnapshot = vtkSmartPointer<vtkPlusTrackedFrameSnapshot>::New();
+    this->TrackedFrameSnapshot->Acquire(this->SelectedChannel);
+  }
+
+  return this->TrackedFrameSnapshot;
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& vtkPlusVisualizationController::GetAcquiredTrackedFrameSnapshots() const
+{
+  return this->AcquiredTrackedFrameSnapshots;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVisualizationController::SetLatestTransformsToRepository()
+{
+  return this->SetTransformsToRepository(this->GetTrackedFrameSnapshot());
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVisualizationController::SetTransformsToRepository(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot)
+{
+  if (aTrackedFrameSnapshot == NULL || !aTrackedFrameSnapshot->IsValid())
+  {
+    LOG_ERROR("Unable to get tracked frame from selected channel!");
+    return PLUS_FAIL;
+  }
+
+  // The repository may have been updated with other frames since the snapshot was taken, so the transforms are always set
+  if (aTrackedFrameSnapshot->SetTransformsToRepository(this->TransformRepository) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to set transforms from tracked frame!");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVisualizationController::SetVolumeMapper(vtkPolyDataMapper* aContourMapper)
 {
@@ -607,15 +761,8 @@ PlusStatus vtkPlusVisualizationController::IsExistingTransform(const char* aTran
       return PLUS_FAIL;
     }
 
-    igsioTrackedFrame trackedFrame;
-    if (this->SelectedChannel->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to get tracked frame from data collector!");
-      return PLUS_FAIL;
-    }
-    if (this->TransformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+    if (this->SetLatestTransformsToRepository() != PLUS_SUCCESS)
     {
-      LOG_ERROR("Unable to set transforms from tracked frame!");
       return PLUS_FAIL;
     }
   }
@@ -745,6 +892,14 @@ PlusStatus vtkPlusVisualizationController::ReadConfiguration(vtkXMLDataElement*
     LOG_ERROR("Unable to initialize transform repository!");
   }
 
+  // Optional limit of the canvas render rate
+  vtkXMLDataElement* renderingElement = aXMLElement->FindNestedElementWithName("Rendering");
+  double maximumRenderFrameRate(0.0);
+  if (renderingElement != NULL && renderingElement->GetScalarAttribute("MaximumRenderFrameRate", maximumRenderFrameRate))
+  {
+    this->SetMaximumRenderFrameRate(maximumRenderFrameRate);
+  }
+
   // Pass on any configuration steps to children
   if (this->PerspectiveVisualizer != NULL)
   {
@@ -804,6 +959,11 @@ PlusStatus vtkPlusVisualizationController::StopAndDisconnectDataCollector()
   this->DisconnectInput();
   SetDataCollector(NULL);   // the local smart pointer still keeps a reference
 
+  // The acquisition thread uses the channel of the data collector
+  this->AcquisitionThread->Stop();
+  this->AcquiredTrackedFrameSnapshots.clear();
+  this->TrackedFrameSnapshot = NULL;
+
   dataCollector->Stop();
   dataCollector->Disconnect();
 
@@ -962,6 +1122,16 @@ void vtkPlusVisualizationController::SetInputData(vtkImageData* input)
 void vtkPlusVisualizationController::SetSelectedChannel(vtkPlusChannel* aChannel)
 {
   this->SelectedChannel = aChannel;
+  this->TrackedFrameSnapshot = NULL;
+  this->AcquiredTrackedFrameSnapshots.clear();
+  this->NumberOfReportedDroppedSnapshots = 0;
+
+  // Acquire the tracked frames of the new channel on the acquisition thread
+  this->AcquisitionThread->Stop();
+  if (aChannel != NULL)
+  {
+    this->AcquisitionThread->Start(aChannel);
+  }
 
   if (this->ImageVisualizer != NULL)
   {
@@ -19,6 +19,8 @@ See License.txt for details.
 #include <QTimer>
 
 // Local includes
+#include "vtkPlusAcquisitionThread.h"
+#include "vtkPlusTrackedFrameSnapshot.h"
 class vtkPlusImageVisualizer;
 class vtkPlus3DObjectVisualizer;
 class vtkPlusDisplayableObject;
@@ -43,6 +45,12 @@ class QResizeEvent;
 Usage: Instantiate, set the QVTKCanvas that is to be managed by this visualizer the call Initialize function. Updating the visualization is done by attaching Update() to a QTimer (self-managed).
 Before calling this, force the data collector to provide new data by calling GetDataCollector()->Modified() function.
 
+The tracked frames of the selected channel are acquired on a worker thread (vtkPlusAcquisitionThread). Update() collects the snapshots that were
+acquired since the previous tick, the latest one is used for the visualization and all of them are available to the toolboxes through GetAcquiredTrackedFrameSnapshots().
+
+Update() re-renders the canvas only if a new tracked frame arrived or a prop, the camera or the image was modified since the last render,
+and not more often than MaximumRenderFrameRate (optional MaximumRenderFrameRate attribute of the Rendering element), so an idle application does almost no work.
+
 It has three modes, DISPLAY_MODE_2D, DISPLAY_MODE_3D and DISPLAY_MODE_NONE. In DISPLAY_MODE_2D it shows only the video input in the whole window. In DISPLAY_MODE_3D, all the devices and
 the image is visible (that are defined in the device set configuration file's Rendering element). In DISPLAY_MODE_NONE the canvas is hidden and all renderers are detached.
 
@@ -168,6 +176,13 @@ public:
   /param aValid True if the transform is valid, false otherwise (optional parameter)
   */
   PlusStatus GetTransformMatrix(igsioTransformName aTransform, vtkMatrix4x4* aOutputMatrix, ToolStatus* aStatus = NULL);
+  /*!
+  Compute transform matrix from the tool transforms of a tracked frame snapshot
+  /param aTrackedFrameSnapshot Snapshot to get the tool transforms from
+  /param aOutputMatrix Out parameter for the transform matrix
+  /param aValid True if the transform is valid, false otherwise (optional parameter)
+  */
+  PlusStatus GetTransformMatrix(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot, igsioTransformName aTransform, vtkMatrix4x4* aOutputMatrix, ToolStatus* aStatus = NULL);
 
   /*!
   Check if a transform exists in transform repository
@@ -175,6 +190,26 @@ public:
   */
   PlusStatus IsExistingTransform(const char* aTransformFrom, const char* aTransformTo, bool aUseLatestTrackedFrame = true);
 
+  /*!
+  Return the snapshot of the latest tracked frame of the selected channel for the current acquisition tick.
+  It is the latest snapshot of the acquisition thread, or if there is none yet then it is acquired on the first request in the tick.
+  All requests in the same tick get the same object. Keep a smart pointer to it if it is used after the tick.
+  IsValid() of the snapshot is false if no frame is available.
+  */
+  vtkPlusTrackedFrameSnapshot* GetTrackedFrameSnapshot();
+
+  /*!
+  Return all snapshots that the acquisition thread acquired between the previous and the current acquisition tick, in acquisition order.
+  Toolboxes that collect calibration data should process all of them so that no samples are lost when the GUI thread is busy.
+  */
+  const std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> >& GetAcquiredTrackedFrameSnapshots() const;
+
+  /*!
+  Return true if the canvas was rendered since the previous call, i.e. the canvas widget needs to be repainted.
+  The request is cleared by the call.
+  */
+  bool ConsumeCanvasUpdateRequest();
+
   /*! Function to handle resize events */
   void resizeEvent(QResizeEvent* aEvent);
 
@@ -300,6 +335,10 @@ public:
   PlusStatus SetAcquisitionFrameRate(int aFrameRate);
   vtkGetMacro(AcquisitionFrameRate, int);
 
+  /*! Set the maximum number of canvas renders per second. Non-positive value means that every acquisition tick may render. */
+  vtkSetMacro(MaximumRenderFrameRate, double);
+  vtkGetMacro(MaximumRenderFrameRate, double);
+
   vtkGetObjectMacro(TransformRepository, vtkIGSIOTransformRepository);
   vtkGetObjectMacro(DataCollector, vtkPlusDataCollector);
 
@@ -322,6 +361,15 @@ protected:
   }
   vtkRenderWindow* GetRenderWindow();
 
+  /*! Set the tool transforms of the tracked frame snapshot of the current acquisition tick to the transform repository */
+  PlusStatus SetLatestTransformsToRepository();
+
+  /*! Set the tool transforms of a tracked frame snapshot to the transform repository */
+  PlusStatus SetTransformsToRepository(vtkPlusTrackedFrameSnapshot* aTrackedFrameSnapshot);
+
+  /*! Return the latest modification time of the renderer, its camera, its props and the displayed image */
+  vtkMTimeType GetSceneModifiedTime(vtkRenderer* aRenderer);
+
 protected:
   /*!
   * Constructor
@@ -352,11 +400,31 @@ protected:
   DISPLAY_MODE                                CurrentMode;
   /*! Desired frame rate of synchronized recording */
   int                                         AcquisitionFrameRate;
+  /*! Maximum number of canvas renders per second */
+  double                                      MaximumRenderFrameRate;
+  /*! System time of the last canvas render */
+  double                                      LastRenderTimeSec;
+  /*! Renderer that was rendered last, a mode switch always triggers a render */
+  vtkRenderer*                                LastRenderedRenderer;
+  /*! Scene modification time right after the last render */
+  vtkMTimeType                                LastRenderedSceneModifiedTime;
+  /*! Timestamp of the tracked frame the 3D objects were last updated with */
+  double                                      LastUpdatedTrackedFrameTimestamp;
+  /*! Flag indicating that the canvas was rendered since the last ConsumeCanvasUpdateRequest() call */
+  bool                                        CanvasUpdateRequested;
   /// Cached variables from other systems
   QVTKOpenGLNativeWidget*                     Canvas;
   vtkIGSIOTransformRepository*                TransformRepository;
   vtkPlusChannel*                             SelectedChannel;
   vtkPlusDataCollector*                       DataCollector;
+  /*! Snapshot of the latest tracked frame of the selected channel, NULL until it is acquired */
+  vtkSmartPointer<vtkPlusTrackedFrameSnapshot> TrackedFrameSnapshot;
+  /*! Worker thread that acquires the snapshots of the selected channel */
+  vtkSmartPointer<vtkPlusAcquisitionThread>   AcquisitionThread;
+  /*! Snapshots acquired by the acquisition thread between the previous and the current acquisition tick */
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameSnapshot> > AcquiredTrackedFrameSnapshots;
+  /*! Number of dropped snapshots of the acquisition thread that has already been reported in the log */
+  unsigned int                                NumberOfReportedDroppedSnapshots;
 };
 
 #endif  // __vtkVisualizationController_h